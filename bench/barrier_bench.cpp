@@ -0,0 +1,84 @@
+#include "../worker_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+1. Purpose
+   Per-round latency of the fork-join primitives in worker_pool.h, against
+   the two things they replace: a plain condition-variable barrier and
+   spawning/joining threads for every parallel section.
+
+2. Build and Run
+   g++ -std=c++17 -O2 -pthread bench/barrier_bench.cpp worker_pool.cpp -o barrier_bench
+   ./barrier_bench [rounds]   (default 20000, split over the thread counts)
+
+3. Columns (microseconds per round, all threads crossing once)
+   - spin : SpinBarrier::arrive_and_wait
+   - cv   : mutex + condition variable barrier (the parking path alone)
+   - pool : WorkerPool::run with an empty task per thread
+   - spawn: create and join threads-1 empty threads
+   With more threads than hardware threads SpinBarrier never spins, so on
+   an oversubscribed host spin and cv measure the same parking path.
+*/
+using Clock = std::chrono::steady_clock;
+
+struct CvBarrier {
+    explicit CvBarrier(int n) : n_(n) {}
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> lock(mu_);
+        const unsigned gen = gen_;
+        if (++count_ == n_) { count_ = 0; gen_++; cv_.notify_all(); }
+        else cv_.wait(lock, [&] { return gen_ != gen; });
+    }
+
+private:
+    const int n_;
+    int count_ = 0;
+    unsigned gen_ = 0;
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+template <class F>
+static double us_per_round(int rounds, F f) {
+    const auto t0 = Clock::now();
+    for (int r = 0; r < rounds; ++r) f();
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / rounds;
+}
+
+// Run `rounds` crossings of barrier b on n threads (the caller included).
+template <class B>
+static double barrier_round(int n, int rounds) {
+    B b(n);
+    std::vector<std::thread> th;
+    for (int k = 1; k < n; ++k)
+        th.emplace_back([&] { for (int r = 0; r < rounds; ++r) b.arrive_and_wait(); });
+    const double us = us_per_round(rounds, [&] { b.arrive_and_wait(); });
+    for (auto& t : th) t.join();
+    return us;
+}
+
+int main(int argc, char** argv) {
+    const int total = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20000;
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    std::printf("threads      spin        cv      pool     spawn\n");
+    for (int n : {2, 4, 8, 16, 32, 64}) {
+        const int rounds = total / n + 200;
+        const double spin = barrier_round<SpinBarrier>(n, rounds);
+        const double cv   = barrier_round<CvBarrier>(n, rounds);
+
+        WorkerPool pool(n);
+        const std::function<void(int)> nop = [](int) {};
+        const double run = us_per_round(rounds, [&] { pool.run(n, nop); });
+
+        const double spawn = us_per_round(std::min(rounds, 300), [&] {
+            std::vector<std::thread> th;
+            for (int k = 1; k < n; ++k) th.emplace_back([] {});
+            for (auto& t : th) t.join();
+        });
+        std::printf("%7d %9.1f %9.1f %9.1f %9.1f\n", n, spin, cv, run, spawn);
+    }
+    return 0;
+}
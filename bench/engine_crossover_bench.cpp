@@ -0,0 +1,88 @@
+#include "../engine_select.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/*
+1. Purpose
+   Measures the all-pairs vs cell-grid crossover that make_simulator()'s
+   heuristic encodes. For each packing fraction and radius dispersion it
+   times steady-state microseconds per event (queue already built) for
+   all-pairs and for the heuristic grid size, over a range of N.
+
+2. Build and Run
+   g++ -std=c++17 -O2 -pthread bench/engine_crossover_bench.cpp $(ls *.cpp | grep -v -e main.cpp -e sim_capi) -o engine_crossover_bench
+   ./engine_crossover_bench [events]   (default 20000 per point)
+
+3. Systems
+   Bidisperse disks (radius r, and k*r for every `every`-th disk) placed by
+   random sequential addition at the target packing fraction, random
+   velocities. k = 8 with 2% large disks is the case where the largest
+   diameter, not the target occupancy, sets the cell size.
+*/
+using Clock = std::chrono::steady_clock;
+
+// Random sequential placement, largest disks first; every `every`-th disk
+// has radius k*r, the rest r.
+static std::vector<Particle> make_system(int n, double phi, double k, int every, SimConfig& cfg) {
+    const double r = 0.5;
+    const int big = n / every;
+    const double area = 3.14159265358979 * r * r * ((n - big) + big * k * k);
+    cfg.W = cfg.H = std::sqrt(area / phi);
+
+    std::mt19937 g(n * 31 + (int)(100 * phi) + (int)(10 * k) + every);
+    std::uniform_real_distribution<double> u(0, 1);
+    std::vector<Particle> P;
+    for (int i = 0; i < n; ++i) {
+        const double rad = i < big ? k * r : r;
+        for (int attempt = 0; ; ++attempt) {
+            const Vec2 at(rad + u(g) * (cfg.W - 2 * rad), rad + u(g) * (cfg.H - 2 * rad));
+            bool free = true;
+            for (const Particle& q : P) {
+                const Vec2 d = at - q.r;
+                if (d.x * d.x + d.y * d.y < (rad + q.rad) * (rad + q.rad)) { free = false; break; }
+            }
+            if (free) { P.emplace_back(at, Vec2(2 * u(g) - 1, 2 * u(g) - 1), rad, 1.0); break; }
+            if (attempt > 100000) { P.clear(); return P; } // too dense to place
+        }
+    }
+    return P;
+}
+
+static double us_per_event(SimConfig cfg, const std::vector<Particle>& P, double cell, int events) {
+    cfg.cell_size = cell;
+    Simulator s(cfg, P);
+    s.step(1); // build the queue outside the timed part
+    const auto t0 = Clock::now();
+    const int done = s.step(events);
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / std::max(1, done);
+}
+
+int main(int argc, char** argv) {
+    const int events = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::printf("  phi  spread     N    occ  pick  all-pairs      grid   (us/event)\n");
+    struct Mix { double k; int every; };
+    for (Mix mix : {Mix{1.0, 1}, Mix{2.0, 2}, Mix{4.0, 2}, Mix{8.0, 50}})
+        for (double phi : {0.05, 0.2, 0.35}) {
+            for (int n : {32, 64, 128, 256, 512, 1024, 2048}) {
+                SimConfig cfg;
+                cfg.T_end = 1e9;
+                cfg.enable_rollback = false;
+                cfg.print_final = false;
+                const std::vector<Particle> P = make_system(n, phi, mix.k, mix.every, cfg);
+                if (P.empty()) continue;
+                const EngineChoice est = estimate_system(cfg, P);
+                const double cell = grid_cell_size(cfg, P);
+                const bool   grid = cell > 0 && n > 16.0 * est.occupancy;
+                const double ap   = us_per_event(cfg, P, 0.0, events);
+                const double gr   = cell > 0 ? us_per_event(cfg, P, cell, events) : 0.0;
+                std::printf("%5.2f  %6.2f  %5d  %5.1f  %4s  %9.3f  %8.3f\n", est.packing_fraction,
+                            est.radius_spread, n, est.occupancy, grid ? "grid" : "all", ap, gr);
+            }
+            std::printf("\n");
+        }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "../simulator.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/*
+1. Purpose
+   Wall-clock cost per processed event for the smooth-disk build and the
+   rough-disk build (-DSIM_ROUGH_DISKS), so the price of the larger
+   particle record and the tangential impulse can be compared. The rough
+   build runs each case with cfg.beta = -1 (smooth physics, rough layout)
+   and with beta = 0.5.
+
+2. Build and Run
+   g++ -std=c++17 -O2 -pthread bench/event_cost_bench.cpp $(ls *.cpp | grep -v -e main.cpp -e sim_capi) -o event_cost_smooth
+   g++ -std=c++17 -O2 -pthread -DSIM_ROUGH_DISKS bench/event_cost_bench.cpp $(ls *.cpp | grep -v -e main.cpp -e sim_capi) -o event_cost_rough
+   ./event_cost_smooth [events]; ./event_cost_rough [events]   (default 1000000)
+*/
+using Clock = std::chrono::steady_clock;
+
+static void measure(int n, double spacing, int events, double beta) {
+    const int side = (int)std::ceil(std::sqrt((double)n));
+    SimConfig cfg;
+    cfg.W = cfg.H = side * spacing;
+    cfg.T_end = 1e9;
+    cfg.max_events = events;
+    cfg.cell_size = spacing;
+    cfg.enable_rollback = false;
+    cfg.print_final = false;
+#ifdef SIM_ROUGH_DISKS
+    cfg.beta = beta;
+#else
+    (void)beta;
+#endif
+    std::mt19937 g(11);
+    std::uniform_real_distribution<double> u(-1, 1);
+    std::vector<Particle> P;
+    for (int i = 0; i < n; ++i) {
+        P.emplace_back(Vec2((i % side + 0.5) * spacing, (i / side + 0.5) * spacing), Vec2(u(g), u(g)), 0.4, 1.0);
+#ifdef SIM_ROUGH_DISKS
+        P.back().w = u(g);
+#endif
+    }
+
+    Simulator s(cfg, P);
+    const auto t0 = Clock::now();
+    s.run();
+    const double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    const double phi = n * 3.14159265358979 * 0.16 / (cfg.W * cfg.H);
+    std::printf("%7d  %5.3f  %5.1f  %8.3f  %11.2f\n", n, phi, beta, us / s.stats().events,
+                (double)s.stats().stale / s.stats().events);
+}
+
+int main(int argc, char** argv) {
+    const int events = argc > 1 ? std::atoi(argv[1]) : 1000000;
+#ifdef SIM_ROUGH_DISKS
+    std::printf("rough build, sizeof(Particle) = %zu\n", sizeof(Particle));
+    const double betas[] = {-1.0, 0.5};
+#else
+    std::printf("smooth build, sizeof(Particle) = %zu\n", sizeof(Particle));
+    const double betas[] = {-1.0};
+#endif
+    std::printf("      n    phi   beta  us/event  stale/event\n");
+    for (double spacing : {2.0, 1.0})
+        for (double beta : betas) measure(20000, spacing, events, beta);
+    return 0;
+}
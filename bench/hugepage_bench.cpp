@@ -0,0 +1,151 @@
+#include "../simulator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+1. Purpose
+   Throughput with and without huge-page backing (hugepage_alloc.h):
+   - gather: random 8-byte reads over a large HugePageAllocator array,
+     the TLB-bound worst case;
+   - sim: events per second of a large cell-grid run with cfg.huge_pages
+     OFF vs TRANSPARENT (vs EXPLICIT if a hugetlbfs pool exists).
+   AnonHugePages from /proc/self/smaps_rollup shows whether the kernel
+   actually promoted the ranges. Each timed section also reports its
+   dTLB load misses from perf_event_open when the kernel exposes that
+   counter (perf_event_paranoid, containers and VMs often hide it); if it
+   is missing the bench says so and measures throughput only.
+
+2. Build and Run
+   g++ -std=c++17 -O2 -pthread bench/hugepage_bench.cpp $(ls *.cpp | grep -v -e main.cpp -e sim_capi) -o hugepage_bench
+   ./hugepage_bench [gather MB] [particles]   (default 512, 200000)
+*/
+using Clock = std::chrono::steady_clock;
+
+static long anon_huge_kb() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string key;
+    long kb = 0;
+    while (in >> key) {
+        if (key == "AnonHugePages:") { in >> kb; return kb; }
+        in.ignore(256, '\n');
+    }
+    return -1;
+}
+
+// dTLB load misses of this thread while running; -1 when unavailable.
+class DtlbMisses {
+public:
+    DtlbMisses() {
+#if defined(__linux__)
+        perf_event_attr a{};
+        a.size = sizeof(a);
+        a.type = PERF_TYPE_HW_CACHE;
+        a.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        a.disabled = 1;
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        fd_ = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+        if (fd_ >= 0) { ioctl(fd_, PERF_EVENT_IOC_RESET, 0); ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+    ~DtlbMisses() {
+#if defined(__linux__)
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+    DtlbMisses(const DtlbMisses&) = delete;
+    DtlbMisses& operator=(const DtlbMisses&) = delete;
+
+    long long stop() {
+#if defined(__linux__)
+        long long v = 0;
+        if (fd_ < 0) return -1;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        return read(fd_, &v, sizeof(v)) == (ssize_t)sizeof(v) ? v : -1;
+#else
+        return -1;
+#endif
+    }
+
+private:
+    int fd_ = -1;
+};
+
+static std::string misses(long long m) {
+    if (m < 0) return "dTLB n/a";
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "dTLB %8.2f M misses", m / 1e6);
+    return buf;
+}
+
+static const char* name(HugePages m) {
+    return m == HugePages::OFF ? "off" : m == HugePages::TRANSPARENT ? "transparent" : "explicit";
+}
+
+static void gather(HugePages mode, std::size_t mb) {
+    const std::size_t n = mb * (std::size_t(1) << 20) / sizeof(std::uint64_t);
+    std::vector<std::uint64_t, HugePageAllocator<std::uint64_t>> a(n, 0, HugePageAllocator<std::uint64_t>(mode));
+    for (std::size_t i = 0; i < n; ++i) a[i] = i * 0x9e3779b97f4a7c15ull;
+    const long huge = anon_huge_kb();
+
+    const std::size_t reads = 20000000;
+    std::uint64_t x = 1, sum = 0;
+    DtlbMisses tlb;
+    const auto t0 = Clock::now();
+    for (std::size_t k = 0; k < reads; ++k) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        sum += a[x % n];
+    }
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    const long long m = tlb.stop();
+    std::printf("gather %-11s %5zu MB  %6.1f M reads/s  %s  AnonHugePages %7ld kB  (%llu)\n",
+                name(mode), mb, reads / s / 1e6, misses(m).c_str(), huge, (unsigned long long)(sum & 1));
+}
+
+static void sim(HugePages mode, int n) {
+    const int side = (int)std::ceil(std::sqrt((double)n));
+    SimConfig cfg;
+    cfg.W = cfg.H = side * 1.0;
+    cfg.T_end = 1e9;
+    cfg.max_events = 1000000;
+    cfg.cell_size = 1.0;
+    cfg.enable_rollback = false;
+    cfg.print_final = false;
+    cfg.huge_pages = mode;
+    std::mt19937 g(5);
+    std::uniform_real_distribution<double> u(-1, 1);
+    std::vector<Particle> P;
+    for (int i = 0; i < n; ++i)
+        P.emplace_back(Vec2((i % side) + 0.5, (i / side) + 0.5), Vec2(u(g), u(g)), 0.35, 1.0);
+
+    Simulator s(cfg, P);
+    DtlbMisses tlb;
+    const auto t0 = Clock::now();
+    s.run();
+    const double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+    const long long m = tlb.stop();
+    std::printf("sim    %-11s %7d particles  %6.3f M events/s  %s  AnonHugePages %7ld kB\n",
+                name(mode), n, s.stats().events / sec / 1e6, misses(m).c_str(), anon_huge_kb());
+}
+
+int main(int argc, char** argv) {
+    const std::size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    const int n = argc > 2 ? std::atoi(argv[2]) : 200000;
+    if (DtlbMisses().stop() < 0)
+        std::printf("dTLB-load-misses counter unavailable: throughput only, TLB effect not measured\n");
+    for (HugePages m : {HugePages::OFF, HugePages::TRANSPARENT, HugePages::EXPLICIT}) gather(m, mb);
+    for (HugePages m : {HugePages::OFF, HugePages::TRANSPARENT, HugePages::EXPLICIT}) sim(m, n);
+    return 0;
+}
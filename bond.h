@@ -0,0 +1,20 @@
+#ifndef BOND_H
+#define BOND_H
+
+/*
+1. Purpose
+   Tether between two particles: their centers may not separate beyond L.
+   Used for chains/polymers; the simulator keeps one Tether per side, so
+   each particle can list its bonded neighbours in O(bonds per particle).
+
+2. Events
+   BOND events fire when the distance reaches L while separating (outer
+   root of the same quadratic as time_to_pp) and reflect the normal
+   relative velocity, like a contact seen from the inside.
+*/
+struct Tether {
+    int    j; // bonded partner
+    double L; // maximum center distance
+};
+
+#endif // BOND_H
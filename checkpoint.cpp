@@ -0,0 +1,663 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <cstdio>
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+constexpr std::uint8_t kMagic[4] = {'P', 'C', 'K', 'P'};
+constexpr std::uint32_t kVersion = 3; // 2: collision counters, kick phase; 3: frames, digest
+
+#ifdef SIM_ROUGH_DISKS
+constexpr std::uint8_t kFlagRough = 1;
+#else
+constexpr std::uint8_t kFlagRough = 0;
+#endif
+#ifdef SIM_FIXED_POINT
+constexpr std::uint8_t kFlagFixed = 2;
+constexpr std::uint8_t kFracBits  = SIM_FIXED_FRAC_BITS;
+#else
+constexpr std::uint8_t kFlagFixed = 0;
+constexpr std::uint8_t kFracBits  = 0;
+#endif
+
+/*
+1. Byte Buffers
+   Explicit little-endian encoding; Reader turns every overrun into
+   ok = false instead of reading past the end.
+*/
+void put_u8(Bytes& b, std::uint8_t x) { b.push_back(x); }
+void put_u32(Bytes& b, std::uint32_t x) { for (int k = 0; k < 4; ++k) b.push_back(std::uint8_t(x >> (8 * k))); }
+void put_u64(Bytes& b, std::uint64_t x) { for (int k = 0; k < 8; ++k) b.push_back(std::uint8_t(x >> (8 * k))); }
+void put_var(Bytes& b, std::uint64_t x) {
+    while (x >= 0x80) { b.push_back(std::uint8_t(x | 0x80)); x >>= 7; }
+    b.push_back(std::uint8_t(x));
+}
+
+std::uint64_t bits_of(double d) { std::uint64_t u; std::memcpy(&u, &d, 8); return u; }
+double double_of(std::uint64_t u) { double d; std::memcpy(&d, &u, 8); return d; }
+void put_f64(Bytes& b, double d) { put_u64(b, bits_of(d)); }
+
+std::uint64_t zigzag(std::int64_t v) { return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63); }
+std::int64_t unzigzag(std::uint64_t u) { return std::int64_t(u >> 1) ^ -std::int64_t(u & 1); }
+
+struct Reader {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    bool ok = true;
+
+    std::uint8_t u8() {
+        if (p >= end) { ok = false; return 0; }
+        return *p++;
+    }
+    std::uint32_t u32() { std::uint32_t x = 0; for (int k = 0; k < 4; ++k) x |= std::uint32_t(u8()) << (8 * k); return x; }
+    std::uint64_t u64() { std::uint64_t x = 0; for (int k = 0; k < 8; ++k) x |= std::uint64_t(u8()) << (8 * k); return x; }
+    double f64() { return double_of(u64()); }
+    std::uint64_t var() {
+        std::uint64_t x = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const std::uint8_t c = u8();
+            x |= std::uint64_t(c & 0x7F) << shift;
+            if (!(c & 0x80)) return x;
+        }
+        ok = false;
+        return 0;
+    }
+    const std::uint8_t* take(std::size_t n) {
+        if ((std::size_t)(end - p) < n) { ok = false; return nullptr; }
+        const std::uint8_t* q = p;
+        p += n;
+        return q;
+    }
+};
+
+/*
+2. rANS Entropy Coder
+   Static order-0 model with 12-bit probabilities and a 32-bit state
+   (byte-wise renormalization). The frequency table travels with each
+   stream. A constant stream has one symbol at full probability and codes
+   to just the 4-byte final state.
+*/
+constexpr std::uint32_t kProbBits  = 12;
+constexpr std::uint32_t kProbScale = 1u << kProbBits;
+constexpr std::uint32_t kRansL     = 1u << 23;
+
+void normalize(const std::uint64_t cnt[256], std::uint64_t total, std::uint32_t freq[256]) {
+    std::uint32_t sum = 0;
+    int best = 0;
+    for (int s = 0; s < 256; ++s) {
+        freq[s] = cnt[s] ? std::max<std::uint32_t>(1, std::uint32_t(cnt[s] * kProbScale / total)) : 0;
+        sum += freq[s];
+        if (cnt[s] > cnt[best]) best = s;
+    }
+    if (sum < kProbScale) { freq[best] += kProbScale - sum; return; }
+    // Rounding rare symbols up to 1 overshoots; take it from the largest.
+    while (sum > kProbScale) {
+        int big = 0;
+        for (int s = 1; s < 256; ++s) if (freq[s] > freq[big]) big = s;
+        const std::uint32_t cut = std::min(sum - kProbScale, freq[big] - 1);
+        freq[big] -= cut;
+        sum -= cut;
+    }
+}
+
+void rans_put(Bytes& out, const Bytes& in) {
+    put_var(out, in.size());
+    if (in.empty()) return;
+
+    std::uint64_t cnt[256] = {};
+    for (std::uint8_t c : in) cnt[c]++;
+    std::uint32_t freq[256], cum[256];
+    normalize(cnt, in.size(), freq);
+    for (int s = 0, c = 0; s < 256; ++s) { cum[s] = c; c += freq[s]; put_var(out, freq[s]); }
+
+    // Encode backwards so the decoder runs forwards; <= 2 bytes per symbol.
+    Bytes buf(2 * in.size() + 8);
+    std::uint8_t* const end = buf.data() + buf.size();
+    std::uint8_t* ptr = end;
+    std::uint32_t x = kRansL;
+    for (std::size_t i = in.size(); i-- > 0; ) {
+        const std::uint32_t f = freq[in[i]];
+        const std::uint32_t x_max = ((kRansL >> kProbBits) << 8) * f;
+        while (x >= x_max) { *--ptr = std::uint8_t(x); x >>= 8; }
+        x = ((x / f) << kProbBits) + (x % f) + cum[in[i]];
+    }
+    ptr -= 4;
+    for (int k = 0; k < 4; ++k) ptr[k] = std::uint8_t(x >> (8 * k));
+
+    put_var(out, std::uint64_t(end - ptr));
+    out.insert(out.end(), ptr, end);
+}
+
+bool rans_get(Reader& rd, Bytes& out) {
+    const std::uint64_t n = rd.var();
+    if (!rd.ok || n > (std::uint64_t(1) << 40)) return false;
+    out.resize(n);
+    if (n == 0) return true;
+
+    std::uint32_t freq[256], cum[256], sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        const std::uint64_t f = rd.var();
+        if (f > kProbScale) return false;
+        freq[s] = std::uint32_t(f);
+        cum[s] = sum;
+        sum += freq[s];
+    }
+    if (!rd.ok || sum != kProbScale) return false;
+    std::array<std::uint8_t, kProbScale> sym;
+    for (int s = 0; s < 256; ++s)
+        std::fill(sym.begin() + cum[s], sym.begin() + cum[s] + freq[s], std::uint8_t(s));
+
+    const std::uint64_t len = rd.var();
+    const std::uint8_t* p = rd.take(len);
+    if (!rd.ok || len < 4) return false;
+    const std::uint8_t* const end = p + len;
+    std::uint32_t x = 0;
+    for (int k = 0; k < 4; ++k) x |= std::uint32_t(p[k]) << (8 * k);
+    p += 4;
+
+    for (std::uint64_t i = 0; i < n; ++i) {
+        const std::uint32_t slot = x & (kProbScale - 1);
+        const std::uint8_t s = sym[slot];
+        out[i] = s;
+        x = freq[s] * (x >> kProbBits) + slot - cum[s];
+        while (x < kRansL) {
+            if (p >= end) return false;
+            x = (x << 8) | *p++;
+        }
+    }
+    return true;
+}
+
+/*
+3. Field Streams
+   - planes: XOR with the previous value, then one rANS stream per byte
+     of the 64-bit residual (lossless doubles).
+   - ints:   zigzag varints of value (or delta to the previous), one rANS
+     stream (quantized values, fixed-point coordinates, slot ids).
+*/
+template <class Get>
+void put_planes(Bytes& out, std::size_t m, Get get) {
+    std::array<Bytes, 8> planes;
+    for (auto& pl : planes) pl.reserve(m);
+    std::uint64_t prev = 0;
+    for (std::size_t k = 0; k < m; ++k) {
+        const std::uint64_t u = bits_of(get(k));
+        const std::uint64_t d = u ^ prev;
+        prev = u;
+        for (int b = 0; b < 8; ++b) planes[b].push_back(std::uint8_t(d >> (8 * b)));
+    }
+    for (const auto& pl : planes) rans_put(out, pl);
+}
+
+bool get_planes(Reader& rd, std::size_t m, std::vector<double>& vals) {
+    std::array<Bytes, 8> planes;
+    for (auto& pl : planes)
+        if (!rans_get(rd, pl) || pl.size() != m) return false;
+    vals.resize(m);
+    std::uint64_t prev = 0;
+    for (std::size_t k = 0; k < m; ++k) {
+        std::uint64_t d = 0;
+        for (int b = 0; b < 8; ++b) d |= std::uint64_t(planes[b][k]) << (8 * b);
+        prev ^= d;
+        vals[k] = double_of(prev);
+    }
+    return true;
+}
+
+template <class Get>
+void put_ints(Bytes& out, std::size_t m, bool delta, Get get) {
+    Bytes tmp;
+    tmp.reserve(2 * m);
+    std::int64_t prev = 0;
+    for (std::size_t k = 0; k < m; ++k) {
+        const std::int64_t q = get(k);
+        put_var(tmp, zigzag(delta ? q - prev : q));
+        prev = q;
+    }
+    rans_put(out, tmp);
+}
+
+bool get_ints(Reader& rd, std::size_t m, bool delta, std::vector<std::int64_t>& vals) {
+    Bytes tmp;
+    if (!rans_get(rd, tmp)) return false;
+    Reader r{tmp.data(), tmp.data() + tmp.size()};
+    vals.resize(m);
+    std::int64_t prev = 0;
+    for (std::size_t k = 0; k < m; ++k) {
+        const std::int64_t q = unzigzag(r.var());
+        vals[k] = delta ? prev + q : q;
+        prev = vals[k];
+    }
+    return r.ok && r.p == r.end;
+}
+
+/*
+4. Morton Order and Threads
+*/
+std::uint64_t spread(std::uint32_t v) {
+    std::uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+std::uint32_t morton_coord(double x, double L) {
+    const double f = std::min(std::max(x / L, 0.0), 1.0);
+    return std::uint32_t(std::min(f * 4294967296.0, 4294967295.0));
+}
+
+int thread_count(int requested) {
+    return requested > 0 ? requested : (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run f(0 .. tasks-1) on up to `threads` threads.
+template <class F>
+void parallel_for(int tasks, int threads, F f) {
+    threads = std::max(1, std::min(threads, tasks));
+    std::atomic<int> next(0);
+    auto worker = [&]() { for (int k; (k = next.fetch_add(1)) < tasks; ) f(k); };
+    std::vector<std::thread> pool;
+    for (int k = 1; k < threads; ++k) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// Slot ids in Morton order of their centers: chunk sorts, then pairwise merges.
+std::vector<std::uint32_t> morton_order(const Particle* P, std::size_t n, double W, double H, int threads) {
+    using Item = std::pair<std::uint64_t, std::uint32_t>;
+    std::vector<Item> items(n);
+    const int chunks = (int)std::max<std::size_t>(1, std::min<std::size_t>(threads, n / 4096));
+    const std::size_t len = (n + chunks - 1) / chunks;
+    parallel_for(chunks, threads, [&](int c) {
+        const std::size_t lo = c * len, hi = std::min(n, lo + len);
+        for (std::size_t i = lo; i < hi; ++i)
+            items[i] = Item(spread(morton_coord(P[i].r.x, W)) | (spread(morton_coord(P[i].r.y, H)) << 1),
+                            std::uint32_t(i));
+        std::sort(items.begin() + lo, items.begin() + hi);
+    });
+    for (std::size_t width = len; width < n; width *= 2) {
+        const int merges = (int)((n + 2 * width - 1) / (2 * width));
+        parallel_for(merges, threads, [&](int k) {
+            const std::size_t lo = k * 2 * width;
+            const std::size_t mid = std::min(n, lo + width), hi = std::min(n, lo + 2 * width);
+            std::inplace_merge(items.begin() + lo, items.begin() + mid, items.begin() + hi);
+        });
+    }
+    std::vector<std::uint32_t> ids(n);
+    for (std::size_t i = 0; i < n; ++i) ids[i] = items[i].second;
+    return ids;
+}
+
+/*
+5. Blocks
+   A block is a run of slots (in Morton order for the compressed modes):
+   count, then the field streams in a fixed order.
+*/
+struct Steps {
+    double pos = 0.0, vel = 0.0; // LOSSY quantization steps
+};
+
+void encode_block(const Particle* P, const std::uint32_t* ids, std::size_t m,
+                  CkptMode mode, Steps st, Bytes& out) {
+    put_var(out, m);
+    auto at = [&](std::size_t k) -> const Particle& { return P[ids[k]]; };
+
+    if (mode == CkptMode::RAW) {
+        for (std::size_t k = 0; k < m; ++k) {
+            const Particle& p = at(k);
+            put_u32(out, ids[k]);
+            put_u8(out, p.alive ? 1 : 0);
+            put_f64(out, p.r.x); put_f64(out, p.r.y);
+            put_f64(out, p.v.x); put_f64(out, p.v.y);
+            put_f64(out, p.rad); put_f64(out, p.m);
+            put_u32(out, std::uint32_t(p.coll_count));
+#ifdef SIM_ROUGH_DISKS
+            put_f64(out, p.w); put_f64(out, p.I);
+#endif
+#ifdef SIM_FIXED_POINT
+            put_u64(out, std::uint64_t(p.q.x)); put_u64(out, std::uint64_t(p.q.y));
+#endif
+        }
+        return;
+    }
+
+    put_ints(out, m, true, [&](std::size_t k) { return std::int64_t(ids[k]); });
+    Bytes alive(m);
+    for (std::size_t k = 0; k < m; ++k) alive[k] = at(k).alive ? 1 : 0;
+    rans_put(out, alive);
+
+    if (mode == CkptMode::LOSSY) {
+        put_ints(out, m, true,  [&](std::size_t k) { return std::llround(at(k).r.x / st.pos); });
+        put_ints(out, m, true,  [&](std::size_t k) { return std::llround(at(k).r.y / st.pos); });
+        put_ints(out, m, false, [&](std::size_t k) { return std::llround(at(k).v.x / st.vel); });
+        put_ints(out, m, false, [&](std::size_t k) { return std::llround(at(k).v.y / st.vel); });
+    } else {
+#ifdef SIM_FIXED_POINT
+        put_ints(out, m, true, [&](std::size_t k) { return at(k).q.x; });
+        put_ints(out, m, true, [&](std::size_t k) { return at(k).q.y; });
+#else
+        put_planes(out, m, [&](std::size_t k) { return at(k).r.x; });
+        put_planes(out, m, [&](std::size_t k) { return at(k).r.y; });
+#endif
+        put_planes(out, m, [&](std::size_t k) { return at(k).v.x; });
+        put_planes(out, m, [&](std::size_t k) { return at(k).v.y; });
+    }
+    put_planes(out, m, [&](std::size_t k) { return at(k).rad; });
+    put_planes(out, m, [&](std::size_t k) { return at(k).m; });
+    put_ints(out, m, false, [&](std::size_t k) { return std::int64_t(at(k).coll_count); });
+#ifdef SIM_ROUGH_DISKS
+    put_planes(out, m, [&](std::size_t k) { return at(k).w; });
+    put_planes(out, m, [&](std::size_t k) { return at(k).I; });
+#endif
+}
+
+#ifdef SIM_ROUGH_DISKS
+constexpr std::size_t kRoughBytes = 16;
+#else
+constexpr std::size_t kRoughBytes = 0;
+#endif
+#ifdef SIM_FIXED_POINT
+constexpr std::size_t kFixedBytes = 16;
+#else
+constexpr std::size_t kFixedBytes = 0;
+#endif
+// id, alive, r, v, rad, m, collision count, then the build-dependent fields.
+constexpr std::size_t kRawRecord = 4 + 1 + 6 * 8 + 4 + kRoughBytes + kFixedBytes;
+
+// seen[id] is claimed before a slot is written, so a slot listed twice
+// (in one block or two) fails instead of racing.
+bool decode_block(Reader rd, CkptMode mode, Steps st, double t, std::vector<Particle>& out,
+                  std::atomic<std::uint8_t>* seen) {
+    const std::size_t n = out.size();
+    const std::uint64_t m = rd.var();
+    if (!rd.ok || m > n) return false;
+
+    if (mode == CkptMode::RAW) {
+        for (std::uint64_t k = 0; k < m; ++k) {
+            const std::uint32_t id = rd.u32();
+            if (id >= n || seen[id].exchange(1)) return false;
+            Particle& p = out[id];
+            p.alive = rd.u8() != 0;
+            p.r.x = rd.f64(); p.r.y = rd.f64();
+            p.v.x = rd.f64(); p.v.y = rd.f64();
+            p.rad = rd.f64(); p.m = rd.f64();
+            p.coll_count = (int)rd.u32();
+#ifdef SIM_ROUGH_DISKS
+            p.w = rd.f64(); p.I = rd.f64();
+#endif
+#ifdef SIM_FIXED_POINT
+            p.q.x = (fix64)rd.u64(); p.q.y = (fix64)rd.u64();
+#endif
+            p.t = t;
+        }
+        return rd.ok;
+    }
+
+    std::vector<std::int64_t> ids, qx, qy, qvx, qvy, hits;
+    std::vector<double> x, y, vx, vy, rad, mass;
+    Bytes alive;
+    if (!get_ints(rd, m, true, ids)) return false;
+    if (!rans_get(rd, alive) || alive.size() != m) return false;
+    if (mode == CkptMode::LOSSY) {
+        if (!get_ints(rd, m, true, qx) || !get_ints(rd, m, true, qy) ||
+            !get_ints(rd, m, false, qvx) || !get_ints(rd, m, false, qvy)) return false;
+    } else {
+#ifdef SIM_FIXED_POINT
+        if (!get_ints(rd, m, true, qx) || !get_ints(rd, m, true, qy)) return false;
+#else
+        if (!get_planes(rd, m, x) || !get_planes(rd, m, y)) return false;
+#endif
+        if (!get_planes(rd, m, vx) || !get_planes(rd, m, vy)) return false;
+    }
+    if (!get_planes(rd, m, rad) || !get_planes(rd, m, mass)) return false;
+    if (!get_ints(rd, m, false, hits)) return false;
+#ifdef SIM_ROUGH_DISKS
+    std::vector<double> w, I;
+    if (!get_planes(rd, m, w) || !get_planes(rd, m, I)) return false;
+#endif
+
+    for (std::uint64_t k = 0; k < m; ++k) {
+        if (ids[k] < 0 || (std::uint64_t)ids[k] >= n || seen[ids[k]].exchange(1)) return false;
+        Particle& p = out[ids[k]];
+        p.alive = alive[k] != 0;
+        p.rad = rad[k];
+        p.m   = mass[k];
+        if (mode == CkptMode::LOSSY) {
+            p.v = Vec2(qvx[k] * st.vel, qvy[k] * st.vel);
+            p.place(Vec2(qx[k] * st.pos, qy[k] * st.pos));
+        } else {
+            p.v = Vec2(vx[k], vy[k]);
+#ifdef SIM_FIXED_POINT
+            p.q = FixVec2{qx[k], qy[k]};
+            p.r = from_fix(p.q);
+#else
+            p.r = Vec2(x[k], y[k]);
+#endif
+        }
+#ifdef SIM_ROUGH_DISKS
+        p.w = w[k];
+        p.I = I[k];
+#endif
+        p.t = t;
+        p.coll_count = (int)hits[k];
+    }
+    return true;
+}
+
+} // namespace
+
+// LOSSY codes llround(x / step) as int64 deltas. Values are capped at 2^62
+// steps so the delta of two neighbours cannot overflow either; a step too
+// fine for the data (or not a positive finite number) is rejected.
+static bool quantizable(const Particle* P, std::size_t n, const Steps& st) {
+    if (!(st.pos > 0) || !(st.vel > 0) || !std::isfinite(st.pos) || !std::isfinite(st.vel)) return false;
+    double rmax = 0.0, vmax = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        rmax = std::max({rmax, std::abs(P[i].r.x), std::abs(P[i].r.y)});
+        vmax = std::max({vmax, std::abs(P[i].v.x), std::abs(P[i].v.y)});
+    }
+    const double limit = std::ldexp(1.0, 62);
+    return rmax / st.pos <= limit && vmax / st.vel <= limit; // false for NaN too
+}
+
+/*
+6. Container
+   magic, version, mode, flags, frac bits, t, W, H, n, steps, run state,
+   block size, block count, per-block byte sizes, then the blocks back to
+   back.
+*/
+std::vector<std::uint8_t> encode_checkpoint(double t, double W, double H,
+                                            const Particle* P, std::size_t n,
+                                            const CheckpointOptions& opt,
+                                            const CheckpointRun& run) {
+    const int threads = thread_count(opt.threads);
+    const std::size_t block = (std::size_t)std::max(1, opt.block);
+    Steps st;
+    if (opt.mode == CkptMode::LOSSY) {
+        st.pos = 2.0 * std::max(opt.pos_error, 1e-300);
+        st.vel = 2.0 * std::max(opt.vel_error, 1e-300);
+        if (!quantizable(P, n, st)) return {};
+    }
+
+    std::vector<std::uint32_t> ids;
+    if (opt.mode == CkptMode::RAW) {
+        ids.resize(n);
+        for (std::size_t i = 0; i < n; ++i) ids[i] = std::uint32_t(i);
+    } else {
+        ids = morton_order(P, n, W, H, threads);
+    }
+
+    const int nblocks = (int)((n + block - 1) / block);
+    std::vector<Bytes> blocks(nblocks);
+    parallel_for(nblocks, threads, [&](int b) {
+        const std::size_t lo = b * block;
+        encode_block(P, ids.data() + lo, std::min(block, n - lo), opt.mode, st, blocks[b]);
+    });
+
+    Bytes out;
+    for (std::uint8_t c : kMagic) put_u8(out, c);
+    put_u32(out, kVersion);
+    put_u8(out, std::uint8_t(opt.mode));
+    put_u8(out, kFlagRough | kFlagFixed);
+    put_u8(out, kFracBits);
+    put_f64(out, t); put_f64(out, W); put_f64(out, H);
+    put_u64(out, n);
+    put_f64(out, st.pos); put_f64(out, st.vel);
+    put_u64(out, std::uint64_t(run.kick_next));
+    put_u8(out, run.kick_half ? 1 : 0);
+    put_u64(out, std::uint64_t(run.frame_next));
+    put_u64(out, std::uint64_t(run.hashed));
+    put_u64(out, run.digest);
+    put_u32(out, std::uint32_t(block));
+    put_u32(out, std::uint32_t(nblocks));
+    for (const auto& b : blocks) put_u64(out, b.size());
+    for (const auto& b : blocks) out.insert(out.end(), b.begin(), b.end());
+    return out;
+}
+
+bool decode_checkpoint(const std::uint8_t* data, std::size_t size,
+                       std::vector<Particle>& out, CheckpointInfo& info, int threads) {
+    Reader rd{data, data + size};
+    const std::uint8_t* magic = rd.take(4);
+    if (!rd.ok || std::memcmp(magic, kMagic, 4) != 0 || rd.u32() != kVersion) return false;
+    const std::uint8_t mode  = rd.u8();
+    const std::uint8_t flags = rd.u8();
+    const std::uint8_t frac  = rd.u8();
+    if (mode > 2 || flags != (kFlagRough | kFlagFixed) || frac != kFracBits) return false;
+
+    info.mode  = CkptMode(mode);
+    info.t     = rd.f64();
+    info.W     = rd.f64();
+    info.H     = rd.f64();
+    info.n     = rd.u64();
+    info.bytes = size;
+    Steps st;
+    st.pos = rd.f64();
+    st.vel = rd.f64();
+    info.run.kick_next = (std::int64_t)rd.u64();
+    info.run.kick_half = rd.u8() != 0;
+    info.run.frame_next = (std::int64_t)rd.u64();
+    info.run.hashed     = (std::int64_t)rd.u64();
+    info.run.digest     = rd.u64();
+    rd.u32(); // block size (informational)
+    const std::uint32_t nblocks = rd.u32();
+    if (!rd.ok || info.n > 0xFFFFFFFFull || nblocks > info.n + 1 ||
+        nblocks > std::size_t(rd.end - rd.p) / 8) return false;
+
+    // Block counts must add up to n before anything of size n is
+    // allocated, and a RAW block must be big enough for its records, so a
+    // corrupt n is rejected instead of turning into a huge allocation.
+    std::vector<Reader> parts;
+    std::vector<std::uint64_t> sizes(nblocks);
+    for (auto& s : sizes) s = rd.u64();
+    std::uint64_t listed = 0;
+    for (std::uint64_t s : sizes) {
+        const std::uint8_t* p = rd.take(s);
+        if (!rd.ok) return false;
+        Reader peek{p, p + s};
+        const std::uint64_t m = peek.var();
+        if (!peek.ok || m > info.n - listed) return false;
+        if (info.mode == CkptMode::RAW && m > std::uint64_t(peek.end - peek.p) / kRawRecord) return false;
+        listed += m;
+        parts.push_back(Reader{p, p + s});
+    }
+    if (listed != info.n) return false;
+
+    // The sizes agree, so every slot listed exactly once (seen) means
+    // every slot is covered.
+    try {
+        out.assign(info.n, Particle());
+        std::unique_ptr<std::atomic<std::uint8_t>[]> seen(new std::atomic<std::uint8_t>[info.n]());
+        std::atomic<bool> ok(true);
+        parallel_for((int)nblocks, thread_count(threads), [&](int b) {
+            try {
+                if (!decode_block(parts[b], info.mode, st, info.t, out, seen.get())) ok = false;
+            } catch (const std::bad_alloc&) {
+                ok = false;
+            }
+        });
+        return ok;
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+}
+
+/*
+7. Files
+   Writes go to path + ".tmp", are flushed to disk and then renamed over
+   path, so an interrupted write (a budget stop on its way out, a killed
+   job) leaves the previous checkpoint intact. The rename is atomic on
+   POSIX file systems; elsewhere the file is replaced after a full write.
+*/
+static bool write_file(const std::string& path, const Bytes& data) {
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (std::size_t off = 0; ok && off < data.size(); ) {
+        const ssize_t w = ::write(fd, data.data() + off, data.size() - off);
+        if (w < 0 && errno == EINTR) continue;
+        ok = w > 0;
+        if (ok) off += (std::size_t)w;
+    }
+    ok = ok && ::fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#else
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+    f.flush();
+    return (bool)f;
+#endif
+}
+
+bool write_checkpoint(const std::string& path, double t, double W, double H,
+                      const Particle* P, std::size_t n, const CheckpointOptions& opt,
+                      const CheckpointRun& run) {
+    const Bytes data = encode_checkpoint(t, W, H, P, n, opt, run);
+    if (data.empty()) return false;
+
+    const std::string tmp = path + ".tmp";
+    if (!write_file(tmp, data)) { std::remove(tmp.c_str()); return false; }
+#if !defined(__unix__) && !defined(__APPLE__)
+    std::remove(path.c_str()); // rename() does not replace files here
+#endif
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) { std::remove(tmp.c_str()); return false; }
+#if defined(__unix__) || defined(__APPLE__)
+    // Persist the rename itself (best effort).
+    const std::size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    const int dfd = ::open(dir.c_str(), O_RDONLY);
+    if (dfd >= 0) { ::fsync(dfd); ::close(dfd); }
+#endif
+    return true;
+}
+
+bool read_checkpoint(const std::string& path, std::vector<Particle>& out,
+                     CheckpointInfo& info, int threads) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    const Bytes data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return decode_checkpoint(data.data(), data.size(), out, info, threads);
+}
@@ -0,0 +1,100 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "particle.h"
+
+/*
+1. Purpose
+   Full-state checkpoints (time, box, every particle slot) for restart and
+   offline analysis, with an optional compressing codec.
+
+2. Modes
+   - RAW      : fixed-width little-endian fields, slot order.
+   - LOSSLESS : bit-exact. Particles are Morton-sorted; each double field
+                is XORed with the previous particle's value and split into
+                byte planes (high planes are mostly zero), fixed-point
+                positions are delta-coded as integers.
+   - LOSSY    : positions and velocities are quantized to a step of twice
+                the requested error and delta/varint coded in Morton order;
+                radius, mass (and spin) stay exact. Meant for analysis and
+                movies: a restart may see overlaps of up to pos_error.
+   Every byte stream is entropy-coded with a static order-0 rANS coder.
+
+3. Layout and Parallelism
+   - Slots are split into blocks of `block` particles after sorting; each
+     block is coded independently and its size is stored in the header,
+     so encoding and decoding both run one block per thread.
+   - Slot ids are stored (delta coded), so restarts keep particle identity
+     (bonds, probes, inlet recycling all refer to slots).
+   - Per-particle times are not stored: a checkpoint is taken after
+     sync_all(), so every particle is valid at t. Collision counters are
+     stored, so per-particle collision counts continue across a restart.
+   - CheckpointRun carries the schedule state that cannot be derived from
+     t: the soft-force kick phase (which kick is next and whether it is the
+     half kick), the next frame index, and the event-digest chain. Deriving
+     kicks and frames from t is ambiguous when one falls exactly on t.
+
+4. Notes
+   - Reading requires the same SIM_ROUGH_DISKS / SIM_FIXED_POINT build as
+     writing; mismatches are rejected.
+   - write_checkpoint() writes path + ".tmp", fsyncs it and renames it
+     over path, so a write cut short never destroys the last checkpoint.
+   - LOSSY rejects errors so small that a position or velocity would be
+     more than 2^62 steps (encode_checkpoint() then returns no bytes and
+     write_checkpoint() false).
+   - Functions return false on I/O or format errors; nothing throws. The
+     decoder checks that the blocks list every slot exactly once before
+     accepting a file, and that the block counts add up to n before it
+     allocates n slots. There is no checksum: a flipped payload byte in a
+     RAW file decodes to a different value.
+*/
+
+enum class CkptMode : std::uint8_t { RAW = 0, LOSSLESS = 1, LOSSY = 2 };
+
+struct CheckpointOptions {
+    CkptMode mode      = CkptMode::LOSSLESS;
+    double   pos_error = 1e-6;    // LOSSY: max abs position error
+    double   vel_error = 1e-6;    // LOSSY: max abs velocity component error
+    int      threads   = 0;       // 0 = std::thread::hardware_concurrency()
+    int      block     = 1 << 16; // particles per independently coded block
+};
+
+// Simulator schedule state that a restart needs besides the particles.
+struct CheckpointRun {
+    std::int64_t  kick_next  = -1;    // next soft-force kick index (-1 = none)
+    bool          kick_half  = false; // that kick is the opening Verlet half kick
+    std::int64_t  frame_next = -1;    // next SAMPLE frame index (-1 = no sampler)
+    std::int64_t  hashed     = 0;     // events folded into digest (0 = digests off)
+    std::uint64_t digest     = 0;     // event-hash chain state (see digest.h)
+};
+
+struct CheckpointInfo {
+    double      t = 0.0, W = 0.0, H = 0.0;
+    std::size_t n = 0;     // particle slots
+    CkptMode    mode = CkptMode::RAW;
+    std::size_t bytes = 0; // encoded size
+    CheckpointRun run;
+};
+
+// In-memory codec.
+std::vector<std::uint8_t> encode_checkpoint(double t, double W, double H,
+                                            const Particle* P, std::size_t n,
+                                            const CheckpointOptions& opt = {},
+                                            const CheckpointRun& run = {});
+bool decode_checkpoint(const std::uint8_t* data, std::size_t size,
+                       std::vector<Particle>& out, CheckpointInfo& info,
+                       int threads = 0);
+
+// File wrappers.
+bool write_checkpoint(const std::string& path, double t, double W, double H,
+                      const Particle* P, std::size_t n, const CheckpointOptions& opt = {},
+                      const CheckpointRun& run = {});
+bool read_checkpoint(const std::string& path, std::vector<Particle>& out,
+                     CheckpointInfo& info, int threads = 0);
+
+#endif // CHECKPOINT_H
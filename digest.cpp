@@ -0,0 +1,61 @@
+#include "digest.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+/*
+1. Hash
+   Each 64-bit word goes through the splitmix64 finalizer after being
+   added to the state, so a single flipped bit in t changes every later
+   digest.
+*/
+static inline std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+void EventHasher::add(const Event& e) {
+    const bool pair = e.type == EventType::P_P || e.type == EventType::BOND;
+    const int lo = pair ? std::min(e.a, e.b) : e.a;
+    const int hi = pair ? std::max(e.a, e.b) : e.b;
+    std::uint64_t tbits;
+    std::memcpy(&tbits, &e.t, sizeof(tbits));
+
+    const std::uint64_t ids = (std::uint64_t(std::uint32_t(lo)) << 32) | std::uint32_t(hi);
+    h_ = mix(h_ + 0x9e3779b97f4a7c15ull + std::uint64_t(e.type));
+    h_ = mix(h_ + ids);
+    h_ = mix(h_ + tbits);
+}
+
+long long first_divergence(const std::vector<EventDigest>& a, const std::vector<EventDigest>& b) {
+    const size_t n = std::min(a.size(), b.size());
+    for (size_t k = 0; k < n; ++k)
+        if (a[k].index != b[k].index || a[k].hash != b[k].hash) return (long long)k;
+    return -1;
+}
+
+/*
+2. Files
+   stdio rather than iostreams: libstdc++ cannot parse hexfloats back.
+*/
+bool write_digests(const std::string& path, const std::vector<EventDigest>& d) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    for (const EventDigest& x : d)
+        std::fprintf(f, "%lld %a %016" PRIx64 "\n", x.index, x.t, x.hash);
+    return std::fclose(f) == 0;
+}
+
+bool read_digests(const std::string& path, std::vector<EventDigest>& d) {
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) return false;
+    d.clear();
+    EventDigest x;
+    while (std::fscanf(f, "%lld %la %" SCNx64, &x.index, &x.t, &x.hash) == 3) d.push_back(x);
+    const bool ok = std::feof(f) != 0;
+    std::fclose(f);
+    return ok;
+}
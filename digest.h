@@ -0,0 +1,69 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "event.h"
+
+/*
+1. Purpose
+   Cheap determinism check across builds (compiler, -O level, -march,
+   -ffast-math, PGO). With cfg.digest_every > 0 the simulator folds every
+   processed state-changing event (type, particle ids, exact bits of t)
+   into a running 64-bit hash and records it every digest_every such
+   events. Two builds that
+   produce the same digest list processed the same event stream; the
+   first differing digest brackets the first divergent event without any
+   full event log.
+
+2. Finding the Event
+   - first_divergence() gives the first differing digest k. The divergent
+     event lies in (digests[k-1].index, digests[k].index].
+   - Rerun both builds with digest_every = 1 and digest_from = the start of
+     that window: every event of the window gets its own digest, and the
+     first mismatch is the event itself (index, t and both hashes).
+
+3. Notes
+   - Stale events are not hashed; they depend on the queue implementation,
+     not on the trajectory. Neither are CELL_CROSS, PROBE and SAMPLE
+     events: probes and the sampler leave the digests unchanged, and the
+     grid no longer shifts digest indices (it still drifts particles at
+     other moments than all-pairs, so event times can differ by an ulp
+     between cell sizes). Pair ids are hashed in (min, max) order.
+   - The hash chains over all events since construction, so one digest
+     covers the whole history up to its index. undo() does not rewind it.
+     Checkpoints carry the chain and its count, so digest indices continue
+     across a restart. A resumed run rebuilds its queue from positions
+     synced at t, which can move later event times by an ulp: compare its
+     digests with another build resumed from the same checkpoint, not with
+     an uninterrupted run.
+   - Text file format, one digest per line: "index t hash", with t as a
+     hexadecimal float and hash as 16 hex digits, so `diff` works too.
+*/
+
+struct EventDigest {
+    long long     index = 0; // events hashed so far (1-based count)
+    double        t     = 0; // time of the last hashed event
+    std::uint64_t hash  = 0; // chained hash of events 1 .. index
+};
+
+class EventHasher {
+public:
+    void add(const Event& e);
+    std::uint64_t value() const { return h_; }
+    void restore(std::uint64_t h) { h_ = h; }
+
+private:
+    std::uint64_t h_ = 0x6a09e667f3bcc908ull;
+};
+
+// Index of the first differing digest, or -1 if the shorter list is a
+// prefix of the longer one.
+long long first_divergence(const std::vector<EventDigest>& a, const std::vector<EventDigest>& b);
+
+bool write_digests(const std::string& path, const std::vector<EventDigest>& d);
+bool read_digests(const std::string& path, std::vector<EventDigest>& d);
+
+#endif // DIGEST_H
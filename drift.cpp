@@ -0,0 +1,81 @@
+#include "drift.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static_assert(offsetof(Vec2, y) == sizeof(double), "Vec2 must be two packed doubles");
+
+static constexpr std::size_t kMinChunk = std::size_t(1) << 17; // particles per thread
+
+/*
+1. Chunk Kernel
+*/
+static void drift_range(Particle* P, std::size_t lo, std::size_t hi, double T) {
+#if defined(SIM_FIXED_POINT)
+    for (std::size_t i = lo; i < hi; ++i) {
+        P[i].drift(T - P[i].t);
+        P[i].t = T;
+    }
+#elif defined(__SSE2__)
+    for (std::size_t i = lo; i < hi; ++i) {
+        Particle& p = P[i];
+        const __m128d dt = _mm_set1_pd(T - p.t);
+        const __m128d r  = _mm_loadu_pd(&p.r.x);
+        const __m128d v  = _mm_loadu_pd(&p.v.x);
+        _mm_storeu_pd(&p.r.x, _mm_add_pd(r, _mm_mul_pd(v, dt)));
+        p.t = T;
+    }
+#else
+    for (std::size_t i = lo; i < hi; ++i) {
+        Particle& p = P[i];
+        const double dt = T - p.t;
+        p.r.x += p.v.x * dt;
+        p.r.y += p.v.y * dt;
+        p.t = T;
+    }
+#endif
+}
+
+/*
+2. Parallel Split
+*/
+int drift_split(std::size_t n, int threads) {
+    const std::size_t k = threads > 0 ? (std::size_t)threads
+                                      : std::max(1u, std::thread::hardware_concurrency());
+    return (int)std::max<std::size_t>(1, std::min(k, n / kMinChunk));
+}
+
+void bulk_drift(Particle* P, std::size_t n, double T, int threads, WorkerPool* pool) {
+    const std::size_t k = pool ? (std::size_t)drift_split(n, pool->size()) : drift_split(n, threads);
+    if (k == 1) { drift_range(P, 0, n, T); return; }
+
+    const std::size_t chunk = (n + k - 1) / k;
+    if (pool) {
+        pool->run_static((int)k, [&](int c) {
+            drift_range(P, c * chunk, std::min(n, (c + 1) * chunk), T);
+        });
+        return;
+    }
+    std::vector<std::thread> spawned;
+    for (std::size_t c = 1; c < k; ++c)
+        spawned.emplace_back(drift_range, P, c * chunk, std::min(n, (c + 1) * chunk), T);
+    drift_range(P, 0, chunk, T);
+    for (auto& t : spawned) t.join();
+}
+
+void first_touch(void* raw, std::size_t n, WorkerPool& pool) {
+    const std::size_t k = (std::size_t)drift_split(n, pool.size());
+    const std::size_t chunk = (n + k - 1) / k;
+    unsigned char* bytes = static_cast<unsigned char*>(raw);
+    pool.run_static((int)k, [&](int c) {
+        const std::size_t lo = c * chunk, hi = std::min(n, (c + 1) * chunk);
+        if (lo < hi) std::memset(bytes + lo * sizeof(Particle), 0, (hi - lo) * sizeof(Particle));
+    });
+}
@@ -0,0 +1,45 @@
+#ifndef DRIFT_H
+#define DRIFT_H
+
+#include <cstddef>
+
+#include "particle.h"
+
+/*
+1. Purpose
+   Bulk lazy-drift kernel: brings every particle to time T with
+   r += v * (T - t_i); t_i = T. Used whenever the full state is needed
+   (sync_all: frames, read-out, rebuilds, the end of run()).
+
+2. Kernel
+   - Branch-free over the particle array (dead slots are drifted too;
+     their positions are never read). Particles already at T move by
+     exactly zero.
+   - r and v are adjacent double pairs, so each particle is one packed
+     SSE2 multiply-add on x86-64; other targets use the scalar loop.
+     Fixed-point builds (SIM_FIXED_POINT) drift the integer position.
+   - The array is split into contiguous chunks across threads for large n
+     (at least kMinChunk particles per thread). The loop is bandwidth
+     bound, so extra threads help until memory saturates.
+   - With a WorkerPool the chunks run on its persistent threads, chunk c
+     always on worker c (run_static); without one, threads are started
+     for the call.
+   - first_touch() faults in the pages of a fresh array chunk by chunk
+     from the workers that will drift them, so with a NUMA-spread pool
+     each chunk is local to the node that streams it.
+*/
+
+class WorkerPool;
+
+// Number of chunks bulk_drift splits n particles into (1 = serial).
+// threads <= 0: std::thread::hardware_concurrency().
+int drift_split(std::size_t n, int threads = 0);
+
+void bulk_drift(Particle* P, std::size_t n, double T, int threads = 0,
+                WorkerPool* pool = nullptr);
+
+// Zero-fills the raw (not yet constructed) storage for n particles with
+// bulk_drift's chunk split on `pool`.
+void first_touch(void* raw, std::size_t n, WorkerPool& pool);
+
+#endif // DRIFT_H
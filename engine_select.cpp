@@ -0,0 +1,117 @@
+#include "engine_select.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kTargetOccupancy = 3.0; // heuristic grid: particles per cell
+
+/*
+1. System Estimate
+   A cell must be at least the largest diameter wide. With N disks of rms
+   radius r filling fraction phi of the box, cells of that width hold
+   (4/pi) * phi * (r_max / r)^2 disks, so dense or widely dispersed
+   systems get fuller cells than kTargetOccupancy.
+*/
+EngineChoice estimate_system(const SimConfig& cfg, const std::vector<Particle>& init) {
+    EngineChoice c;
+    c.n = (int)init.size();
+    if (init.empty()) return c;
+
+    double sum2 = 0.0, rmax = 0.0;
+    for (const auto& p : init) {
+        sum2 += p.rad * p.rad;
+        rmax  = std::max(rmax, p.rad);
+    }
+    const double rms = std::sqrt(sum2 / c.n);
+    c.packing_fraction = kPi * sum2 / (cfg.W * cfg.H);
+    c.radius_spread = rms > 0 ? rmax / rms : 1.0;
+    c.occupancy = std::max(kTargetOccupancy,
+                           4.0 / kPi * c.packing_fraction * c.radius_spread * c.radius_spread);
+    return c;
+}
+
+/*
+2. Candidates
+   Cell sizes targeting 2, 3 and 6 particles per cell plus the tightest
+   legal size (largest diameter). Sizes that leave fewer than 3 cells per
+   side degenerate to all-pairs and are dropped.
+*/
+double grid_cell_size(const SimConfig& cfg, const std::vector<Particle>& init, double occ) {
+    double dmax = 0.0;
+    for (const auto& p : init) dmax = std::max(dmax, 2.0 * p.rad);
+    const double size = std::max(dmax, std::sqrt(occ * cfg.W * cfg.H / init.size()));
+    return size > std::min(cfg.W, cfg.H) / 3.0 ? 0.0 : size;
+}
+
+static std::vector<double> grid_candidates(const SimConfig& cfg, const std::vector<Particle>& init) {
+    std::vector<double> out;
+    for (double occ : {0.0, 2.0, 3.0, 6.0}) {
+        const double size = grid_cell_size(cfg, init, occ);
+        if (size <= 0.0) continue;
+        if (std::none_of(out.begin(), out.end(),
+                         [&](double s) { return std::abs(s - size) < 1e-9 * size; }))
+            out.push_back(size);
+    }
+    return out;
+}
+
+// Trial runs time the engine alone: no budgets, output, sampling or
+// sources. Probes and the sampler attach to a Simulator, not the config,
+// so the fresh trial simulator never has any.
+static double trial_cost(const SimConfig& base, double cell_size,
+                         const std::vector<Particle>& init, int trial_events) {
+    SimConfig cfg = base;
+    cfg.cell_size       = cell_size;
+    cfg.max_events      = trial_events;
+    cfg.wall_budget     = 0.0;
+    cfg.checkpoint_path.clear();
+    cfg.enable_rollback = false;
+    cfg.print_final     = false;
+    cfg.profile_hz      = 0.0;
+    cfg.digest_every    = 0;
+    cfg.collect_histograms = false;
+    cfg.inlets.clear();
+
+    Simulator sim(cfg, init);
+    const auto t0 = std::chrono::steady_clock::now();
+    sim.run();
+    const auto t1 = std::chrono::steady_clock::now();
+    const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    return us / std::max<long long>(1, sim.stats().events);
+}
+
+/*
+3. Factory
+*/
+Simulator make_simulator(SimConfig cfg, std::vector<Particle> init,
+                         bool trial_runs, int trial_events) {
+    EngineChoice c = estimate_system(cfg, init);
+    const double kGridMinNPerOcc = 16.0; // measured crossover (bench/engine_crossover_bench.cpp)
+    const int kAllPairsTrialMaxN = 4000; // O(N^2) setup dominates above this
+
+    if (init.empty()) {
+        c.cell_size = 0.0;
+    } else if (!trial_runs) {
+        c.cell_size = c.n > kGridMinNPerOcc * c.occupancy ? grid_cell_size(cfg, init, kTargetOccupancy) : 0.0;
+    } else {
+        const std::vector<double> grids = grid_candidates(cfg, init);
+        double best = c.n <= kAllPairsTrialMaxN || grids.empty()
+                    ? trial_cost(cfg, 0.0, init, trial_events)
+                    : std::numeric_limits<double>::infinity();
+        c.cell_size = 0.0;
+        for (double size : grids) {
+            const double cost = trial_cost(cfg, size, init, trial_events);
+            if (cost < best) { best = cost; c.cell_size = size; }
+        }
+        c.by_trial = true;
+        c.trial_us_per_event = best;
+    }
+
+    c.engine = c.cell_size > 0.0 ? "cell-grid" : "all-pairs";
+    cfg.cell_size = c.cell_size;
+
+    Simulator sim(cfg, std::move(init));
+    sim.set_engine_choice(c);
+    return sim;
+}
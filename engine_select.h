@@ -0,0 +1,43 @@
+#ifndef ENGINE_SELECT_H
+#define ENGINE_SELECT_H
+
+#include <vector>
+
+#include "simulator.h"
+
+/*
+1. Purpose
+   Front-end factory that picks the pair-search engine and its parameters
+   from the initial particles, so callers don't have to.
+
+2. Inputs
+   - N, packing fraction phi (sum of disk areas / box area) and radius
+     spread (largest radius / rms radius). Together they give the expected
+     occupancy of a grid cell: ~3 by design, or (4/pi) * phi * spread^2
+     when the largest diameter forces bigger cells.
+
+3. Policy
+   - Heuristic: a cell grid sized for ~3 particles per cell (never smaller
+     than the largest diameter) once N > 16 x occupancy, all-pairs below.
+     Measured steady-state cost per event (bench/engine_crossover_bench.cpp):
+     the grid wins from N ~ 48 at occupancy 3 and from N ~ 130 at
+     occupancy 8 (2% disks of 8x radius), regardless of phi otherwise.
+     All-pairs also when the grid would have fewer than 3 cells per side
+     (the 3x3 stencil would cover everything anyway).
+   - Trial mode: time `trial_events` collisions for each candidate on a
+     quiet copy and keep the cheapest per event.
+
+4. Reporting
+   The decision and estimates land in Simulator::stats().choice.
+*/
+
+EngineChoice estimate_system(const SimConfig& cfg, const std::vector<Particle>& init);
+
+// Cell size for ~occupancy particles per cell, at least the largest
+// diameter; 0 if that leaves fewer than 3 cells per side.
+double grid_cell_size(const SimConfig& cfg, const std::vector<Particle>& init, double occupancy = 3.0);
+
+Simulator make_simulator(SimConfig cfg, std::vector<Particle> init,
+                         bool trial_runs = false, int trial_events = 2000);
+
+#endif // ENGINE_SELECT_H
@@ -10,14 +10,39 @@
 2. Event Validation
    We store the coll_count values at scheduling time; if they change by
    the time we pop from the queue, the event is stale and must be skipped.
+
+3. Cell Crossings
+   CELL_CROSS moves particle a into grid cell b. It does not change the
+   particle's velocity, so it does not bump coll_count.
+
+4. Open Systems
+   INSERT fires inlet a for tick b (always valid). REMOVE takes particle a
+   out at an outlet instead of a wall bounce.
+
+5. Tethers
+   BOND is a max-distance bounce between bonded particles a < b; it is
+   validated on both counts like P_P.
+
+6. Probes
+   PROBE emits sample tick b of subscription a (always valid; ignored once
+   the subscription is gone). Like CELL_CROSS it changes no state.
+
+7. Frames
+   SAMPLE emits frame b (at t = b * dt) of the sampler; collA holds the
+   sampler generation, so replacing the sampler invalidates queued frames.
+
+8. Soft Forces
+   KICK applies soft-force kick b (at t = b * cfg.kick_dt) to every live
+   particle (always valid). It changes velocities, so like a collision it
+   is snapshotted and counts against the event budget.
 */
 
-enum class EventType { P_WALL_X, P_WALL_Y, P_P };
+enum class EventType { P_WALL_X, P_WALL_Y, P_P, CELL_CROSS, INSERT, REMOVE, BOND, PROBE, SAMPLE, KICK };
 
 struct Event {
     double    t;// absolute time when the event occurs
-    int       a;// particle index A
-    int       b;// particle index B (or -1 for wall events)
+    int       a;// particle index A (inlet for INSERT, probe for PROBE)
+    int       b;// particle index B (-1 for walls, target cell for CELL_CROSS, tick for INSERT/PROBE, frame for SAMPLE/KICK)
     EventType type;// event kind
     int       collA;// particle a collision count at schedule time
     int       collB;// particle b collision count at schedule time (or -1)
@@ -0,0 +1,54 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "vec2.h"
+
+/*
+1. Purpose
+   Optional fixed-point positions (build with -DSIM_FIXED_POINT). A double
+   has 53 bits of mantissa wherever the particle is, so far from the origin
+   of a large box the spacing between representable positions grows and
+   contact geometry between small disks gets coarse. A 64-bit integer with
+   SIM_FIXED_FRAC_BITS fractional bits has the same resolution everywhere.
+
+2. Layout
+   - Default 32.32: resolution 2^-32 (~2.3e-10 box units) for |x| < 2^31.
+     For a box of side L, up to 62 - ceil(log2 L) fractional bits fit;
+     near the origin of a small box plain doubles are finer.
+   - Particle::q holds the authoritative position; Particle::r mirrors it
+     as a double for read-out, rendering and probes.
+   - Velocities and times stay double; a drift rounds v * dt to the nearest
+     quantum, so per-step error is at most half a quantum.
+
+3. Relative Coordinates
+   Collision math works on differences (pair separation, distance to a
+   wall or cell face). These are formed exactly in integers and only then
+   converted, so neighbours (3x3 cells apart at most) are resolved to one
+   quantum regardless of where they sit in the box. Integer coordinates
+   are also what a checkpoint codec wants to delta-code.
+*/
+
+#ifndef SIM_FIXED_FRAC_BITS
+#define SIM_FIXED_FRAC_BITS 32
+#endif
+
+using fix64 = std::int64_t;
+
+constexpr double kFixScale = double(std::int64_t(1) << SIM_FIXED_FRAC_BITS); // quanta per unit
+constexpr double kFixUnit  = 1.0 / kFixScale;                                // one quantum
+
+inline fix64  to_fix(double x)  { return (fix64)std::llround(x * kFixScale); }
+inline double from_fix(fix64 q) { return (double)q * kFixUnit; }
+
+struct FixVec2 {
+    fix64 x = 0;
+    fix64 y = 0;
+};
+
+inline FixVec2 to_fix(const Vec2& r) { return FixVec2{to_fix(r.x), to_fix(r.y)}; }
+inline Vec2    from_fix(const FixVec2& q) { return Vec2(from_fix(q.x), from_fix(q.y)); }
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,35 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+/*
+1. Purpose
+   Sources and sinks for open systems: inlets inject particles through a
+   span of a wall at a fixed rate, outlets remove particles that reach a
+   span of a wall instead of reflecting them.
+
+2. Determinism
+   Inlet k fires at t = n / rate (n = 1, 2, ...). The spawn point of tick n
+   comes from a golden-ratio sequence along the span, so a rerun (or an
+   undo followed by run) reproduces the same insertions. A tick whose spawn
+   point overlaps an existing particle is skipped.
+*/
+
+enum class Wall { LEFT, RIGHT, BOTTOM, TOP }; // x = 0, x = W, y = 0, y = H
+
+struct Inlet {
+    Wall   wall  = Wall::LEFT;
+    double lo    = 0.0;  // span along the wall (y for LEFT/RIGHT, x otherwise)
+    double hi    = 0.0;
+    double rate  = 1.0;  // insertions per unit time
+    double speed = 1.0;  // injected speed, normal to the wall, into the box
+    double rad   = 0.5;
+    double m     = 1.0;
+};
+
+struct Outlet {
+    Wall   wall = Wall::RIGHT;
+    double lo   = 0.0;   // span along the wall
+    double hi   = 0.0;
+};
+
+#endif // FLOW_H
@@ -0,0 +1,56 @@
+#include "grid.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+1. Build
+   Cell counts are floored so every cell is at least min_size wide; the
+   remainder is spread evenly (cw = W / nx).
+*/
+void CellGrid::build(double W, double H, double min_size, const Particle* P, int n) {
+    nx = std::max(1, (int)std::floor(W / min_size));
+    ny = std::max(1, (int)std::floor(H / min_size));
+    cw = W / nx;
+    ch = H / ny;
+
+    cells.assign((size_t)nx * ny, {});
+    cell_of.assign(n, -1);
+    slot_of.assign(n, -1);
+    for (int i = 0; i < n; ++i)
+        if (P[i].alive) insert(i, cell_at(P[i].r));
+}
+
+/*
+2. Point Location
+   Clamped so particles sitting exactly on the box edge stay in range.
+*/
+int CellGrid::cell_at(const Vec2& r) const {
+    const int x = std::min(nx - 1, std::max(0, (int)(r.x / cw)));
+    const int y = std::min(ny - 1, std::max(0, (int)(r.y / ch)));
+    return cell_id(x, y);
+}
+
+/*
+3. Membership
+   Removal swaps the last member into the vacated slot. Inserting a new
+   index past the end grows the per-particle arrays.
+*/
+void CellGrid::insert(int i, int c) {
+    if (i >= (int)cell_of.size()) {
+        cell_of.resize(i + 1, -1);
+        slot_of.resize(i + 1, -1);
+    }
+    cell_of[i] = c;
+    slot_of[i] = (int)cells[c].size();
+    cells[c].push_back(i);
+}
+
+void CellGrid::remove(int i) {
+    auto& cell = cells[cell_of[i]];
+    const int last = cell.back();
+    cell[slot_of[i]] = last;
+    slot_of[last] = slot_of[i];
+    cell.pop_back();
+    cell_of[i] = -1;
+    slot_of[i] = -1;
+}
@@ -0,0 +1,48 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+
+#include "vec2.h"
+#include "particle.h"
+
+/*
+1. Purpose
+   Uniform cell decomposition of the box used as a neighbour index. Each
+   cell lists the indices of the particles whose centers lie in it (the
+   particle data itself stays in Simulator's array); an index moves to a
+   neighbouring cell when its particle crosses a cell boundary (CELL_CROSS
+   event in Simulator).
+
+2. Invariant
+   Cells are at least one particle diameter wide, so two particles can only
+   touch if their cells are equal or adjacent (3x3 neighbourhood).
+
+3. Complexity
+   - insert / remove / migrate : O(1) (swap-with-last inside the cell)
+   - build                     : O(N + cells)
+*/
+struct CellGrid {
+    int    nx = 0, ny = 0;  // cell counts (0 = grid disabled)
+    double cw = 0, ch = 0;  // cell width / height
+
+    std::vector<std::vector<int>> cells; // particle indices per cell
+    std::vector<int> cell_of;            // owning cell per particle
+    std::vector<int> slot_of;            // index inside cells[cell_of[i]]
+
+    bool enabled() const { return nx > 0; }
+
+    // Lay out cells of size >= min_size over [0,W]x[0,H] and bin particles.
+    void build(double W, double H, double min_size, const Particle* P, int n);
+
+    int cell_at(const Vec2& r) const;
+    int cell_x(int c) const { return c % nx; }
+    int cell_y(int c) const { return c / nx; }
+    int cell_id(int x, int y) const { return y * nx + x; }
+
+    void insert(int i, int c);
+    void remove(int i);
+    void migrate(int i, int c) { remove(i); insert(i, c); }
+};
+
+#endif // GRID_H
@@ -0,0 +1,47 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cmath>
+
+/*
+1. Purpose
+   Fixed-size, log-binned histogram for per-event statistics. Storage is an
+   inline array, so add()/move() are O(1) and never allocate.
+
+2. Binning
+   Bins are equal-width in log10 over [lo, hi); values below lo (including
+   zero) land in the underflow bin, values at or above hi in the overflow bin.
+   bin_lo(k) gives the lower edge of regular bin k.
+*/
+struct LogHistogram {
+    static constexpr int kMaxBins = 64;
+
+    double lo = 1e-6, hi = 1e6;
+    int    bins = 48;
+    std::array<long long, kMaxBins> counts{};
+    long long underflow = 0, overflow = 0;
+    long long n = 0;
+    double    sum = 0.0;
+
+    LogHistogram() = default;
+    LogHistogram(double lo_, double hi_, int bins_)
+        : lo(lo_), hi(hi_), bins(bins_ < kMaxBins ? bins_ : kMaxBins) {}
+
+    void add(double x)  { slot(x)++; n++; sum += x; }
+    void sub(double x)  { slot(x)--; n--; sum -= x; }
+    void move(double from, double to) { slot(from)--; slot(to)++; sum += to - from; }
+
+    double mean() const { return n > 0 ? sum / n : 0.0; }
+    double bin_lo(int k) const { return lo * std::pow(hi / lo, (double)k / bins); }
+
+private:
+    long long& slot(double x) {
+        if (!(x >= lo)) return underflow;
+        if (x >= hi) return overflow;
+        const int k = (int)(std::log10(x / lo) / std::log10(hi / lo) * bins);
+        return counts[k < bins ? k : bins - 1];
+    }
+};
+
+#endif // HISTOGRAM_H
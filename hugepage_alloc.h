@@ -0,0 +1,107 @@
+#ifndef HUGEPAGE_ALLOC_H
+#define HUGEPAGE_ALLOC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/*
+1. Purpose
+   Standard allocator that backs large blocks (particle arrays, snapshot
+   slots, event heap storage) with 2 MB pages to cut TLB misses.
+
+2. Modes
+   - OFF         : plain operator new, identical to std::allocator.
+   - TRANSPARENT : 2 MB-aligned anonymous mmap + madvise(MADV_HUGEPAGE);
+                   the kernel promotes the range to huge pages when it can.
+   - EXPLICIT    : mmap(MAP_HUGETLB) from the reserved hugetlbfs pool
+                   (vm.nr_hugepages); falls back to TRANSPARENT when the
+                   pool is empty.
+
+3. Notes
+   - Blocks smaller than one huge page always use operator new, so small
+     runs pay nothing. The size alone decides the path, which keeps
+     deallocate() consistent with allocate().
+   - Non-Linux builds treat every mode as OFF.
+   - bench/hugepage_bench.cpp compares throughput across the modes and,
+     where the perf counter is available, dTLB load misses.
+*/
+
+enum class HugePages { OFF, TRANSPARENT, EXPLICIT };
+
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    static constexpr std::size_t kHugePage = std::size_t(2) << 20; // 2 MB
+
+    HugePages mode = HugePages::OFF;
+
+    HugePageAllocator() = default;
+    explicit HugePageAllocator(HugePages m) : mode(m) {}
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>& o) : mode(o.mode) {}
+
+    T* allocate(std::size_t n) {
+        const std::size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes)) return static_cast<T*>(::operator new(bytes));
+#if defined(__linux__)
+        const std::size_t len = round_up(bytes);
+#if defined(MAP_HUGETLB)
+        if (mode == HugePages::EXPLICIT) {
+            void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) return static_cast<T*>(p);
+        }
+#endif
+        // Over-map by one huge page and trim both ends so the block is
+        // 2 MB aligned; unaligned ranges cannot be fully promoted.
+        void* raw = mmap(nullptr, len + kHugePage, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(raw);
+        const std::uintptr_t aligned = (base + kHugePage - 1) & ~(kHugePage - 1);
+        if (aligned > base) munmap(raw, aligned - base);
+        const std::size_t tail = (base + len + kHugePage) - (aligned + len);
+        if (tail > 0) munmap(reinterpret_cast<void*>(aligned + len), tail);
+#if defined(MADV_HUGEPAGE)
+        madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE);
+#endif
+        return reinterpret_cast<T*>(aligned);
+#else
+        return static_cast<T*>(::operator new(bytes));
+#endif
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        const std::size_t bytes = n * sizeof(T);
+        if (!use_mmap(bytes)) { ::operator delete(p); return; }
+#if defined(__linux__)
+        munmap(p, round_up(bytes));
+#else
+        ::operator delete(p);
+#endif
+    }
+
+    bool use_mmap(std::size_t bytes) const {
+        return mode != HugePages::OFF && bytes >= kHugePage;
+    }
+    static std::size_t round_up(std::size_t bytes) {
+        return (bytes + kHugePage - 1) & ~(kHugePage - 1);
+    }
+};
+
+template <class T, class U>
+bool operator==(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) { return a.mode == b.mode; }
+template <class T, class U>
+bool operator!=(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) { return a.mode != b.mode; }
+
+#endif // HUGEPAGE_ALLOC_H
@@ -0,0 +1,152 @@
+#include "numa_placement.h"
+
+#if defined(SIM_HAVE_LIBNUMA)
+#include <numa.h>
+#include <numaif.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+#if !defined(SIM_HAVE_LIBNUMA) && defined(__linux__)
+/*
+1. Sysfs Helpers
+   Node and CPU lists look like "0-7,16-23". Node ids need not be dense
+   (offline or memory-less nodes leave holes), so the table is indexed by
+   id from the "online" list, with an empty set for ids that are absent.
+   It is read once, so pinning per call costs only the syscalls.
+*/
+static std::vector<int> read_list(const std::string& path) {
+    std::ifstream in(path);
+    std::string list;
+    if (!in || !std::getline(in, list)) return {};
+
+    std::vector<int> ids;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        const auto dash = range.find('-');
+        const int lo = std::stoi(range.substr(0, dash));
+        const int hi = (dash == std::string::npos) ? lo : std::stoi(range.substr(dash + 1));
+        for (int k = lo; k <= hi; ++k) ids.push_back(k);
+    }
+    return ids;
+}
+
+struct NodeCpus {
+    bool online = false;
+    cpu_set_t set;
+};
+
+static const std::vector<NodeCpus>& node_cpus() {
+    static const std::vector<NodeCpus> table = [] {
+        const std::string root = "/sys/devices/system/node/";
+        std::vector<NodeCpus> t;
+        for (int node : read_list(root + "online")) {
+            NodeCpus e;
+            CPU_ZERO(&e.set);
+            for (int c : read_list(root + "node" + std::to_string(node) + "/cpulist"))
+                if (c < CPU_SETSIZE) { CPU_SET(c, &e.set); e.online = true; }
+            if (!e.online) continue; // memory-only node: nothing to pin to
+            if ((int)t.size() <= node) t.resize(node + 1);
+            t[node] = e;
+        }
+        return t;
+    }();
+    return table;
+}
+#endif
+
+/*
+2. Node Count
+*/
+int numa_node_count() {
+#if defined(SIM_HAVE_LIBNUMA)
+    if (numa_available() < 0) return 1;
+    return numa_max_node() + 1;
+#elif defined(__linux__)
+    const int n = (int)node_cpus().size();
+    return n > 0 ? n : 1;
+#else
+    return 1;
+#endif
+}
+
+std::vector<int> numa_online_nodes() {
+    std::vector<int> nodes;
+#if defined(SIM_HAVE_LIBNUMA)
+    if (numa_available() >= 0)
+        for (int k = 0; k <= numa_max_node(); ++k)
+            if (numa_bitmask_isbitset(numa_all_nodes_ptr, (unsigned)k)) nodes.push_back(k);
+#elif defined(__linux__)
+    const auto& t = node_cpus();
+    for (int k = 0; k < (int)t.size(); ++k)
+        if (t[k].online) nodes.push_back(k);
+#endif
+    if (nodes.empty()) nodes.push_back(0);
+    return nodes;
+}
+
+/*
+3. Thread Pinning
+   With libnuma we also set the preferred node so later allocations made by
+   this thread (heap growth, snapshots) come from local memory. The sysfs
+   fallback relies on the kernel's default first-touch policy for that.
+*/
+bool numa_pin_to_node(int node) {
+    if (node < 0 || node >= numa_node_count()) return false;
+#if defined(SIM_HAVE_LIBNUMA)
+    if (numa_available() < 0) return false;
+    if (numa_run_on_node(node) != 0) return false;
+    numa_set_preferred(node);
+    return true;
+#elif defined(__linux__)
+    const auto& t = node_cpus();
+    return node < (int)t.size() && t[node].online &&
+           sched_setaffinity(0, sizeof(cpu_set_t), &t[node].set) == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+4. Scoped Pinning
+   Save the affinity (and with libnuma the memory policy) first; if it
+   cannot be saved, do not pin, since it could not be undone.
+*/
+NumaPinScope::NumaPinScope(int node) {
+    if (node < 0) return;
+#if defined(__linux__)
+    cpu_set_t old;
+    if (sched_getaffinity(0, sizeof(old), &old) != 0) return;
+#if defined(SIM_HAVE_LIBNUMA)
+    if (numa_available() < 0) return;
+    const unsigned long maxnode = (unsigned long)numa_max_possible_node() + 1;
+    const unsigned long bits    = 8 * sizeof(unsigned long);
+    nodes_.assign((maxnode + bits - 1) / bits, 0);
+    if (get_mempolicy(&policy_, nodes_.data(), maxnode, nullptr, 0) != 0) return;
+#endif
+    cpus_.resize(sizeof(old));
+    std::memcpy(cpus_.data(), &old, sizeof(old));
+    pinned_ = numa_pin_to_node(node);
+#else
+    (void)node;
+#endif
+}
+
+NumaPinScope::~NumaPinScope() {
+#if defined(__linux__)
+    if (!pinned_) return;
+    cpu_set_t old;
+    std::memcpy(&old, cpus_.data(), sizeof(old));
+    sched_setaffinity(0, sizeof(old), &old);
+#if defined(SIM_HAVE_LIBNUMA)
+    set_mempolicy(policy_, nodes_.data(), (unsigned long)numa_max_possible_node() + 1);
+#endif
+#endif
+}
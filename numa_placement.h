@@ -0,0 +1,56 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <vector>
+
+/*
+1. Purpose
+   NUMA placement helpers used by Simulator to keep particle and event
+   storage on the socket of the thread that processes them.
+
+2. Strategy
+   - Pin the calling thread to the CPUs of a node for the duration of a
+     call (NumaPinScope), restoring the caller's affinity afterwards.
+   - Re-allocate and write the storage from that thread (first touch), so
+     the kernel backs the pages with memory local to the node. Storage
+     grown later while pinned lands there too.
+
+3. Backends
+   - libnuma when built with -DSIM_HAVE_LIBNUMA (link with -lnuma).
+   - Linux fallback: /sys/devices/system/node/online and the nodes'
+     cpulist files + sched_setaffinity.
+   - Other platforms: no-op; pinning reports failure, first touch still
+     places memory on whichever node the thread happens to run on.
+*/
+
+// One past the highest NUMA node id visible to the process (1 if unknown).
+// Ids can have holes; numa_online_nodes() lists the usable ones.
+int numa_node_count();
+
+// Ids of the online nodes with CPUs, ascending ({0} if unknown).
+std::vector<int> numa_online_nodes();
+
+// Restrict the calling thread to the CPUs of `node` and prefer allocations
+// from it. Returns false if the node is invalid or pinning is unsupported.
+// The pin stays until changed; NumaPinScope undoes it.
+bool numa_pin_to_node(int node);
+
+// Pins the calling thread to `node` (if >= 0) for the scope's lifetime and
+// restores the previous CPU affinity (and libnuma memory policy) on exit.
+class NumaPinScope {
+public:
+    explicit NumaPinScope(int node);
+    ~NumaPinScope();
+    NumaPinScope(const NumaPinScope&) = delete;
+    NumaPinScope& operator=(const NumaPinScope&) = delete;
+
+    bool pinned() const { return pinned_; }
+
+private:
+    bool pinned_ = false;
+    std::vector<unsigned char> cpus_;   // saved affinity mask (cpu_set_t bytes)
+    int policy_ = 0;                    // saved memory policy mode (libnuma)
+    std::vector<unsigned long> nodes_;  // saved memory policy node mask (libnuma)
+};
+
+#endif // NUMA_PLACEMENT_H
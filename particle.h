@@ -2,6 +2,9 @@
 #define PARTICLE_H
 
 #include "vec2.h"
+#ifdef SIM_FIXED_POINT
+#include "fixed_point.h"
+#endif
 
 /*
 1. Purpose
@@ -9,17 +12,89 @@
 
 2. Notes
    - coll_count increments on every collision to invalidate stale events.
+   - r is valid at time t; Simulator drifts particles lazily, only when
+     they take part in an event or are read out.
+   - alive is false for a removed particle whose slot awaits reuse; a
+     recycled slot keeps counting coll_count up so old events stay stale.
+   - Building with -DSIM_ROUGH_DISKS adds rotation (angular velocity w and
+     moment of inertia I, uniform disk by default) for rough-sphere
+     collisions. Without it the smooth-disk layout is unchanged.
+   - Building with -DSIM_FIXED_POINT adds the fixed-point position q (see
+     fixed_point.h). place() and drift() keep r and q in step; the
+     geometry helpers below read q when it exists.
+   - position_at(T) is where drift(T - t) would put the particle, without
+     moving it: observers read it so that sampling never changes the
+     rounding of the trajectory.
 */
 struct Particle {
     Vec2   r;// position
     Vec2   v;// velocity
     double rad;// radius
     double m;// mass
+    double t;// time at which r is valid (lazy drift)
     int    coll_count;// collision counter for event validation
+    bool   alive;// false once removed (open systems)
+#ifdef SIM_ROUGH_DISKS
+    double w;// angular velocity (counter-clockwise positive)
+    double I;// moment of inertia
+#endif
+#ifdef SIM_FIXED_POINT
+    FixVec2 q = ::to_fix(r);// authoritative position (fixed point); r mirrors it
+#endif
 
-    Particle() : r(), v(), rad(0.5), m(1.0), coll_count(0) {}
+#ifdef SIM_ROUGH_DISKS
+    Particle() : r(), v(), rad(0.5), m(1.0), t(0.0), coll_count(0), alive(true), w(0.0), I(0.125) {}
     Particle(const Vec2& r_, const Vec2& v_, double rad_, double m_, int cc = 0)
-        : r(r_), v(v_), rad(rad_), m(m_), coll_count(cc) {}
+        : r(r_), v(v_), rad(rad_), m(m_), t(0.0), coll_count(cc), alive(true), w(0.0), I(0.5 * m_ * rad_ * rad_) {}
+#else
+    Particle() : r(), v(), rad(0.5), m(1.0), t(0.0), coll_count(0), alive(true) {}
+    Particle(const Vec2& r_, const Vec2& v_, double rad_, double m_, int cc = 0)
+        : r(r_), v(v_), rad(rad_), m(m_), t(0.0), coll_count(cc), alive(true) {}
+#endif
+
+#ifdef SIM_FIXED_POINT
+    // Set the position; call after writing r directly.
+    void place(const Vec2& p) { q = ::to_fix(p); r = from_fix(q); }
+    void drift(double dt) {
+        q.x += ::to_fix(v.x * dt);
+        q.y += ::to_fix(v.y * dt);
+        r = from_fix(q);
+    }
+    Vec2 position_at(double T) const {
+        const double dt = T - t;
+        return from_fix(FixVec2{q.x + ::to_fix(v.x * dt), q.y + ::to_fix(v.y * dt)});
+    }
+#else
+    void place(const Vec2& p) { r = p; }
+    void drift(double dt) { r = r + v * dt; }
+    Vec2 position_at(double T) const { return r + v * (T - t); }
+#endif
 };
 
+// Separation b.r - a.r, exact in fixed-point builds.
+inline Vec2 separation(const Particle& a, const Particle& b) {
+#ifdef SIM_FIXED_POINT
+    return Vec2(from_fix(b.q.x - a.q.x), from_fix(b.q.y - a.q.y));
+#else
+    return b.r - a.r;
+#endif
+}
+
+// Signed distance from the particle center to the line x = edge (or y).
+inline double gap_x(const Particle& p, double edge) {
+#ifdef SIM_FIXED_POINT
+    return from_fix(to_fix(edge) - p.q.x);
+#else
+    return edge - p.r.x;
+#endif
+}
+
+inline double gap_y(const Particle& p, double edge) {
+#ifdef SIM_FIXED_POINT
+    return from_fix(to_fix(edge) - p.q.y);
+#else
+    return edge - p.r.y;
+#endif
+}
+
 #endif // PARTICLE_H
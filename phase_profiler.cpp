@@ -0,0 +1,113 @@
+#include "phase_profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/time.h>
+#define SIM_HAVE_SIGPROF 1
+#endif
+
+/*
+1. Sampling
+   The handler only does lock-free atomic increments, which is all that is
+   async-signal-safe here.
+*/
+static std::atomic<std::uint64_t> g_samples[kPhaseCount];
+static std::atomic<bool> g_running{false};
+static double g_hz = 0.0;
+
+#if defined(SIM_HAVE_SIGPROF)
+static struct sigaction g_old_action;
+static struct itimerval g_old_timer;
+
+static void on_sigprof(int) {
+    const std::uint8_t p = g_sim_phase.load(std::memory_order_relaxed);
+    g_samples[p < kPhaseCount ? p : 0].fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+bool phase_profiler_start(double hz) {
+#if defined(SIM_HAVE_SIGPROF)
+    if (!(hz > 0) || g_running.exchange(true)) return false;
+    for (auto& s : g_samples) s.store(0, std::memory_order_relaxed);
+    g_hz = hz;
+
+    struct sigaction sa {};
+    sa.sa_handler = on_sigprof;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &g_old_action) != 0) { g_running = false; return false; }
+
+    const long us = std::max(1L, std::lround(1e6 / hz));
+    struct itimerval it {};
+    it.it_interval.tv_sec  = us / 1000000;
+    it.it_interval.tv_usec = us % 1000000;
+    it.it_value = it.it_interval;
+    if (setitimer(ITIMER_PROF, &it, &g_old_timer) != 0) {
+        sigaction(SIGPROF, &g_old_action, nullptr);
+        g_running = false;
+        return false;
+    }
+    return true;
+#else
+    (void)hz;
+    return false;
+#endif
+}
+
+PhaseProfile phase_profiler_stop() {
+    PhaseProfile out;
+#if defined(SIM_HAVE_SIGPROF)
+    if (!g_running) return out;
+    setitimer(ITIMER_PROF, &g_old_timer, nullptr);
+    sigaction(SIGPROF, &g_old_action, nullptr);
+    g_running = false;
+#endif
+    out.hz = g_hz;
+    for (int k = 0; k < kPhaseCount; ++k) out.samples[k] = g_samples[k].load(std::memory_order_relaxed);
+    return out;
+}
+
+/*
+2. Report
+*/
+std::uint64_t PhaseProfile::total() const {
+    std::uint64_t n = 0;
+    for (std::uint64_t s : samples) n += s;
+    return n;
+}
+
+const char* phase_name(Phase p) {
+    switch (p) {
+        case Phase::OTHER:    return "other";
+        case Phase::QUEUE:    return "queue";
+        case Phase::DRIFT:    return "drift";
+        case Phase::RESOLVE:  return "resolve";
+        case Phase::PREDICT:  return "predict";
+        case Phase::REBUILD:  return "rebuild";
+        case Phase::SNAPSHOT: return "snapshot";
+        case Phase::KICK:     return "kick";
+        case Phase::OBSERVE:  return "observe";
+        case Phase::COUNT:    break;
+    }
+    return "?";
+}
+
+void print_phase_profile(std::ostream& os, const PhaseProfile& p) {
+    const std::uint64_t n = p.total();
+    const auto flags = os.flags();
+    const auto prec  = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "Phase profile: " << n << " samples at " << p.hz << " Hz\n";
+    for (int k = 0; k < kPhaseCount; ++k) {
+        if (p.samples[k] == 0) continue;
+        os << "  " << std::left << std::setw(9) << phase_name((Phase)k) << std::right
+           << std::setw(6) << 100.0 * p.samples[k] / n << "%  "
+           << std::setw(9) << (p.hz > 0 ? 1e3 * p.samples[k] / p.hz : 0.0) << " ms\n";
+    }
+    os.flags(flags);
+    os.precision(prec);
+}
@@ -0,0 +1,75 @@
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+/*
+1. Purpose
+   Built-in sampling profiler for production runs where perf is not
+   available. The event loop keeps a one-byte phase tag up to date; a
+   SIGPROF timer (setitimer, process CPU time) samples that tag and bumps
+   a per-phase counter. The result is a flat per-phase profile at a cost
+   of one relaxed byte store per phase change.
+
+2. Phases
+   QUEUE    : popping, validating and pushing events
+   DRIFT    : advancing particles to the current time (lazy and bulk)
+   RESOLVE  : collision rules (walls, pairs, tethers, inserts/removals)
+   PREDICT  : re-predicting a particle's next events
+   REBUILD  : full queue and grid rebuilds (schedule_all)
+   SNAPSHOT : rollback copies
+   KICK     : soft-force kicks
+   OBSERVE  : probes, frames, histograms, digests
+   OTHER    : everything outside the event loop
+
+3. Notes
+   - Linux/POSIX only; elsewhere start() returns false and nothing is
+     sampled. Enabled per run with cfg.profile_hz > 0.
+   - The tag and the counters are process-wide. With several simulators
+     running on different threads the profile is their sum, and a sample
+     is charged to whichever phase was tagged last.
+   - SIGPROF is owned by the profiler while it runs; it cannot be combined
+     with gprof or another ITIMER_PROF user. The previous handler and
+     timer are restored by stop().
+*/
+
+enum class Phase : std::uint8_t {
+    OTHER, QUEUE, DRIFT, RESOLVE, PREDICT, REBUILD, SNAPSHOT, KICK, OBSERVE, COUNT
+};
+
+constexpr int kPhaseCount = (int)Phase::COUNT;
+
+struct PhaseProfile {
+    double        hz = 0.0;                   // sampling rate used
+    std::uint64_t samples[kPhaseCount] = {};  // per Phase
+    std::uint64_t total() const;
+};
+
+inline std::atomic<std::uint8_t> g_sim_phase{0};
+
+inline void set_phase(Phase p) { g_sim_phase.store((std::uint8_t)p, std::memory_order_relaxed); }
+
+// Tags a scope and restores the enclosing phase on exit.
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase p) : prev_(g_sim_phase.load(std::memory_order_relaxed)) { set_phase(p); }
+    ~PhaseScope() { g_sim_phase.store(prev_, std::memory_order_relaxed); }
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    std::uint8_t prev_;
+};
+
+// Start sampling at `hz` samples per CPU second; clears the counters.
+// Returns false if unsupported or already running.
+bool phase_profiler_start(double hz);
+// Stop sampling and return what was collected.
+PhaseProfile phase_profiler_stop();
+
+const char* phase_name(Phase p);
+void print_phase_profile(std::ostream& os, const PhaseProfile& p);
+
+#endif // PHASE_PROFILER_H
@@ -0,0 +1,45 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <functional>
+#include <vector>
+
+#include "vec2.h"
+#include "event.h"
+
+/*
+1. Purpose
+   Streaming queries: watch a set of particle ids or a rectangular region
+   without dumping all N particles.
+
+2. Callback
+   callback(t, type, samples) fires
+   - after every collision (P_WALL_X/Y, P_P, BOND) that involves a watched
+     particle; samples hold the involved particles, post-collision;
+   - at t = k * sample_dt (k = 1, 2, ...) when sample_dt > 0, with
+     type == PROBE; samples hold every watched particle at t.
+   Positions at t are computed for the sampled particles only, without
+   moving them, so the cost is O(watched) plus the grid cells covering
+   the region, and subscribing never changes the trajectory.
+
+3. Notes
+   - Ids refer to slots: with open systems a recycled slot is watched too.
+   - A region watches particles whose center lies in [lo, hi].
+   - The samples vector is reused between calls; copy what you keep.
+*/
+
+struct ProbeSample {
+    int  id;
+    Vec2 r;
+    Vec2 v;
+};
+
+struct Probe {
+    std::vector<int> ids;        // watched particle slots (ignored if region)
+    bool   region = false;       // watch [lo, hi] instead of ids
+    Vec2   lo, hi;
+    double sample_dt = 0.0;      // > 0: periodic samples
+    std::function<void(double, EventType, const std::vector<ProbeSample>&)> callback;
+};
+
+#endif // PROBE_H
@@ -0,0 +1,213 @@
+#include "render.h"
+#include "grid.h"
+#include "checkpoint.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+/*
+1. Image Writers
+   PNG uses zlib "stored" blocks (no compression), which only needs CRC-32
+   and Adler-32; good enough for debugging frames.
+*/
+static bool write_ppm(const std::string& path, int w, int h, const std::vector<std::uint8_t>& rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out << "P6\n" << w << " " << h << "\n255\n";
+    out.write(reinterpret_cast<const char*>(rgb.data()), (std::streamsize)rgb.size());
+    return (bool)out;
+}
+
+static std::uint32_t crc32(const std::uint8_t* p, size_t n, std::uint32_t crc = 0) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_be32(std::vector<std::uint8_t>& v, std::uint32_t x) {
+    v.push_back(x >> 24); v.push_back(x >> 16); v.push_back(x >> 8); v.push_back(x);
+}
+
+static void put_chunk(std::ofstream& out, const char* type, const std::vector<std::uint8_t>& data) {
+    std::vector<std::uint8_t> buf;
+    put_be32(buf, (std::uint32_t)data.size());
+    buf.insert(buf.end(), type, type + 4);
+    buf.insert(buf.end(), data.begin(), data.end());
+    put_be32(buf, crc32(buf.data() + 4, buf.size() - 4));
+    out.write(reinterpret_cast<const char*>(buf.data()), (std::streamsize)buf.size());
+}
+
+static bool write_png(const std::string& path, int w, int h, const std::vector<std::uint8_t>& rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    static const std::uint8_t sig[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    out.write(reinterpret_cast<const char*>(sig), 8);
+
+    std::vector<std::uint8_t> ihdr;
+    put_be32(ihdr, (std::uint32_t)w);
+    put_be32(ihdr, (std::uint32_t)h);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, no interlace
+    put_chunk(out, "IHDR", ihdr);
+
+    // Raw scanlines: filter byte 0 + RGB row.
+    const size_t stride = (size_t)w * 3;
+    std::vector<std::uint8_t> raw;
+    raw.reserve((stride + 1) * h);
+    for (int y = 0; y < h; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + y * stride, rgb.begin() + (y + 1) * stride);
+    }
+
+    std::vector<std::uint8_t> z = {0x78, 0x01};
+    std::uint32_t a = 1, b = 0;
+    for (std::uint8_t c : raw) { a = (a + c) % 65521; b = (b + a) % 65521; }
+    for (size_t off = 0; off < raw.size() || off == 0; ) {
+        const size_t len = std::min<size_t>(65535, raw.size() - off);
+        const bool last = off + len == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back(len & 0xFF); z.push_back(len >> 8);
+        z.push_back(~len & 0xFF); z.push_back((~len >> 8) & 0xFF);
+        z.insert(z.end(), raw.begin() + off, raw.begin() + off + len);
+        off += len;
+        if (last) break;
+    }
+    put_be32(z, (b << 16) | a);
+    put_chunk(out, "IDAT", z);
+    put_chunk(out, "IEND", {});
+    return (bool)out;
+}
+
+/*
+2. Rasterizer
+   Pixel (px, py) has its center at world ((px + 0.5) / sx, H - (py + 0.5) / sy);
+   row 0 is the top of the box. Tile edges come from the grid's cell edges
+   rounded to pixels, so neighbouring tiles share edges and never overlap.
+   Disks are counting-sorted by cell into a packed array first, so each tile
+   streams its 3x3 neighbourhood sequentially instead of chasing indices.
+*/
+struct Disk {
+    float x, y, rad;
+    std::uint8_t rgb[3];
+};
+
+bool render_frame(const Particle* P, int n, double W, double H,
+                  const RenderOptions& opt, const std::string& path, WorkerPool* pool) {
+    const int w = std::max(1, opt.width);
+    const int h = opt.height > 0 ? opt.height : std::max(1, (int)std::lround(w * H / W));
+    const double sx = w / W, sy = h / H;
+
+    double dmax = 0.0, vmax2 = 0.0;
+    for (int i = 0; i < n; ++i) {
+        if (!P[i].alive) continue;
+        dmax  = std::max(dmax, 2.0 * P[i].rad);
+        vmax2 = std::max(vmax2, P[i].v.norm2());
+    }
+    const double vmax = std::sqrt(vmax2);
+
+    // Grid geometry only (no particles); membership goes into `disks`.
+    CellGrid grid;
+    const double tile_world = std::max(opt.tile_px / sx, opt.tile_px / sy);
+    grid.build(W, H, std::max(tile_world, dmax), P, 0);
+    const int tiles = grid.nx * grid.ny;
+
+    std::vector<int> cell(n), start(tiles + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        cell[i] = P[i].alive ? grid.cell_at(P[i].r) : -1;
+        if (cell[i] >= 0) start[cell[i] + 1]++;
+    }
+    for (int c = 0; c < tiles; ++c) start[c + 1] += start[c];
+
+    std::vector<Disk> disks(start[tiles]);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        if (cell[i] < 0) continue;
+        Disk& d = disks[fill[cell[i]]++];
+        d.x = (float)P[i].r.x; d.y = (float)P[i].r.y; d.rad = (float)P[i].rad;
+        d.rgb[0] = d.rgb[1] = d.rgb[2] = 255;
+        if (opt.color_by_speed && vmax > 0) {
+            const double s = std::sqrt(P[i].v.norm2()) / vmax;
+            d.rgb[0] = (std::uint8_t)(255 * s); d.rgb[1] = 64; d.rgb[2] = (std::uint8_t)(255 * (1 - s));
+        }
+    }
+
+    std::vector<std::uint8_t> rgb((size_t)w * h * 3);
+    for (size_t k = 0; k < rgb.size(); k += 3) {
+        rgb[k] = opt.bg[0]; rgb[k + 1] = opt.bg[1]; rgb[k + 2] = opt.bg[2];
+    }
+
+    auto col_of = [&](double x) { return (int)std::lround(x * sx); };
+    auto row_of = [&](double y) { return h - (int)std::lround(y * sy); };
+
+    auto draw_tile = [&](int c) {
+        const int cx = grid.cell_x(c), cy = grid.cell_y(c);
+        const int x0 = col_of(cx * grid.cw), x1 = cx == grid.nx - 1 ? w : col_of((cx + 1) * grid.cw);
+        const int y0 = cy == grid.ny - 1 ? 0 : row_of((cy + 1) * grid.ch), y1 = row_of(cy * grid.ch);
+
+        for (int ny = std::max(0, cy - 1); ny <= std::min(grid.ny - 1, cy + 1); ++ny)
+        for (int nx = std::max(0, cx - 1); nx <= std::min(grid.nx - 1, cx + 1); ++nx) {
+            const int nc = grid.cell_id(nx, ny);
+            for (int k = start[nc]; k < start[nc + 1]; ++k) {
+                const Disk& d = disks[k];
+                const int pxmin = std::max(x0, (int)std::floor((d.x - d.rad) * sx));
+                const int pxmax = std::min(x1 - 1, (int)std::floor((d.x + d.rad) * sx));
+                const int pymin = std::max(y0, (int)std::floor((H - d.y - d.rad) * sy));
+                const int pymax = std::min(y1 - 1, (int)std::floor((H - d.y + d.rad) * sy));
+                if (pxmin > pxmax || pymin > pymax) continue; // culled: misses this tile
+
+                auto plot = [&](int px, int py) {
+                    std::uint8_t* o = &rgb[((size_t)py * w + px) * 3];
+                    o[0] = d.rgb[0]; o[1] = d.rgb[1]; o[2] = d.rgb[2];
+                };
+                bool any = false;
+                for (int py = pymin; py <= pymax; ++py) {
+                    const double dy = (H - (py + 0.5) / sy) - d.y;
+                    for (int px = pxmin; px <= pxmax; ++px) {
+                        const double dx = (px + 0.5) / sx - d.x;
+                        if (dx * dx + dy * dy <= (double)d.rad * d.rad) { plot(px, py); any = true; }
+                    }
+                }
+                if (!any) { // sub-pixel disk: mark the pixel under the center
+                    const int px = (int)std::floor(d.x * sx), py = (int)std::floor((H - d.y) * sy);
+                    if (px >= x0 && px < x1 && py >= y0 && py < y1) plot(px, py);
+                }
+            }
+        }
+    };
+
+    if (pool) {
+        pool->run(tiles, draw_tile);
+    } else {
+        const int threads = opt.threads > 0 ? opt.threads : (int)std::thread::hardware_concurrency();
+        WorkerPool local(std::max(1, std::min(threads, tiles)));
+        local.run(tiles, draw_tile);
+    }
+
+    const bool png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+    return png ? write_png(path, w, h, rgb) : write_ppm(path, w, h, rgb);
+}
+
+/*
+3. Checkpoints
+   A checkpoint is written after a full sync, so every slot is valid at
+   its time and renders as is.
+*/
+bool render_checkpoint(const std::string& checkpoint, const RenderOptions& opt,
+                       const std::string& path, WorkerPool* pool) {
+    std::vector<Particle> P;
+    CheckpointInfo info;
+    if (!read_checkpoint(checkpoint, P, info, opt.threads)) return false;
+    return render_frame(P.data(), (int)P.size(), info.W, info.H, opt, path, pool);
+}
@@ -0,0 +1,54 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <cstdint>
+#include <string>
+
+#include "particle.h"
+
+/*
+1. Purpose
+   Offline rasterizer for visual debugging of large runs: draws particle
+   disks of one frame (or of a checkpoint file) into an RGB image and
+   writes it as PPM or PNG. tools/ckpt_render.cpp is the command-line
+   front end for checkpoints.
+
+2. Parallelism and Culling
+   - The box is split by a CellGrid whose cells are at least one diameter
+     and roughly `tile_px` pixels wide; each cell is one image tile.
+   - Tiles are the tasks of a WorkerPool (worker_pool.h): the caller's
+     pool if given (e.g. one that lives across frames), else one of
+     opt.threads threads for the call. A tile only visits particles of its
+     3x3 cell neighbourhood, clipped to the tile, so every pixel is written
+     by exactly one thread and no locking is needed.
+   - Disks smaller than a pixel still mark the pixel under their center.
+
+3. Output
+   - ".png" paths get an uncompressed (stored-deflate) PNG; anything else
+     a binary PPM (P6). No external image library is required.
+   - Build with -pthread.
+*/
+
+struct RenderOptions {
+    int  width   = 1024; // image width in pixels
+    int  height  = 0;    // 0 = keep the box aspect ratio
+    int  tile_px = 64;   // target tile edge in pixels
+    int  threads = 0;    // without a pool: 0 = std::thread::hardware_concurrency()
+    bool color_by_speed = true; // blue (slow) to red (fast); else white
+    std::uint8_t bg[3] = {0, 0, 0};
+};
+
+class WorkerPool;
+
+// Render n particles in a W x H box to `path`. Dead (removed) particles are
+// skipped. Returns false if the file cannot be written.
+bool render_frame(const Particle* P, int n, double W, double H,
+                  const RenderOptions& opt, const std::string& path,
+                  WorkerPool* pool = nullptr);
+
+// Render the particles of a checkpoint (see checkpoint.h) at its time.
+// Returns false if it cannot be read or the image cannot be written.
+bool render_checkpoint(const std::string& checkpoint, const RenderOptions& opt,
+                       const std::string& path, WorkerPool* pool = nullptr);
+
+#endif // RENDER_H
@@ -0,0 +1,55 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <functional>
+#include <vector>
+
+#include "vec2.h"
+
+/*
+1. Purpose
+   Frame output at exact times t = k * dt without drifting the whole system
+   on every event. A SAMPLE event fires at each frame time; only then are
+   positions at t computed (Particle::position_at, the particles stay
+   put) and the requested fields copied into the frame, so the O(N) cost
+   is paid once per frame and sampling never changes the trajectory.
+
+2. Frames
+   - Fields are structure-of-arrays, one entry per live particle, in slot
+     order; ids[] gives the slot. Unrequested fields stay empty.
+   - The Frame is reused between calls; copy what you keep.
+   - The first frame is the first k * dt at or after the time set_sampler()
+     is called (t = 0 gives a frame of the initial state). Frame times never
+     repeat, even after undo() or a rebuild in run().
+*/
+
+enum SampleField : unsigned {
+    SAMPLE_POS        = 1u << 0,
+    SAMPLE_VEL        = 1u << 1,
+    SAMPLE_RADIUS     = 1u << 2,
+    SAMPLE_COLLISIONS = 1u << 3,
+#ifdef SIM_ROUGH_DISKS
+    SAMPLE_SPIN       = 1u << 4,
+#endif
+};
+
+struct Frame {
+    int      index  = 0;   // k
+    double   t      = 0.0; // k * dt
+    unsigned fields = 0;   // SampleField mask that was filled
+    std::vector<int>    ids;
+    std::vector<Vec2>   r, v;
+    std::vector<double> rad;
+    std::vector<int>    collisions;
+#ifdef SIM_ROUGH_DISKS
+    std::vector<double> w;
+#endif
+};
+
+struct Sampler {
+    double   dt     = 0.0;        // frame interval (<= 0 disables sampling)
+    unsigned fields = SAMPLE_POS; // SampleField mask
+    std::function<void(const Frame&)> emit;
+};
+
+#endif // SAMPLE_H
@@ -0,0 +1,170 @@
+#include "sim_capi.h"
+#include "simulator.h"
+#include "engine_select.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+
+/*
+1. Handle
+   Owns the Simulator. Config and stats structs are copied by prefix
+   (min of the caller's and our size), which is what keeps older and newer
+   callers working against one library.
+*/
+struct SimHandle {
+    Simulator sim;
+};
+
+// Runs f, mapping any C++ exception to a status code.
+template <class F>
+static SimStatus guarded(F&& f) {
+    try { return f(); }
+    catch (const std::bad_alloc&) { return SIM_ENOMEM; }
+    catch (...) { return SIM_EINTERNAL; }
+}
+
+int32_t sim_api_version(void) { return SIM_API_VERSION; }
+
+void sim_config_init(SimConfigC* cfg) {
+    if (!cfg) return;
+    const SimConfig d;
+    *cfg = SimConfigC{};
+    cfg->size               = sizeof(SimConfigC);
+    cfg->W                  = d.W;
+    cfg->H                  = d.H;
+    cfg->cell_size          = d.cell_size;
+    cfg->enable_rollback    = 0; // snapshots cost O(N) per event
+    cfg->rollback_depth     = d.rollback_depth;
+    cfg->numa_node          = d.numa_node;
+    cfg->huge_pages         = (int32_t)d.huge_pages;
+    cfg->collect_histograms = d.collect_histograms ? 1 : 0;
+}
+
+/*
+2. Lifetime
+*/
+SimStatus sim_create(const SimConfigC* cfg, const SimParticleC* init, int32_t n, SimHandle** out) {
+    if (!cfg || !out || n < 0 || (n > 0 && !init)) return SIM_EINVAL;
+    if (cfg->size < offsetof(SimConfigC, cell_size)) return SIM_EINVAL;
+    *out = nullptr;
+
+    SimConfigC c;
+    sim_config_init(&c);
+    std::memcpy(&c, cfg, std::min<size_t>(cfg->size, sizeof(c)));
+    if (!(c.W > 0) || !(c.H > 0) || c.huge_pages < 0 || c.huge_pages > 2) return SIM_EINVAL;
+
+    return guarded([&]() -> SimStatus {
+        SimConfig sc;
+        sc.W                  = c.W;
+        sc.H                  = c.H;
+        sc.cell_size          = std::max(0.0, c.cell_size);
+        sc.enable_rollback    = c.enable_rollback != 0;
+        sc.rollback_depth     = c.rollback_depth;
+        sc.numa_node          = c.numa_node;
+        sc.huge_pages         = (HugePages)c.huge_pages;
+        sc.collect_histograms = c.collect_histograms != 0;
+        sc.print_final        = false;
+        sc.T_end              = std::numeric_limits<double>::infinity(); // no horizon
+
+        std::vector<Particle> P;
+        P.reserve(n);
+        for (int32_t i = 0; i < n; ++i) {
+            const SimParticleC& p = init[i];
+            if (!(p.rad > 0) || !(p.m > 0)) return SIM_EINVAL;
+            P.emplace_back(Vec2(p.x, p.y), Vec2(p.vx, p.vy), p.rad, p.m);
+        }
+        *out = c.cell_size < 0 ? new SimHandle{make_simulator(sc, std::move(P))}
+                               : new SimHandle{Simulator(sc, std::move(P))};
+        return SIM_OK;
+    });
+}
+
+void sim_destroy(SimHandle* h) { delete h; }
+
+/*
+3. Stepping
+*/
+SimStatus sim_step(SimHandle* h, int32_t max_events, int32_t* done) {
+    if (!h || max_events < 0) return SIM_EINVAL;
+    return guarded([&]() -> SimStatus {
+        const int k = h->sim.step(max_events);
+        if (done) *done = k;
+        return SIM_OK;
+    });
+}
+
+SimStatus sim_advance_until(SimHandle* h, double t, int32_t max_events, int32_t* done) {
+    if (!h || !(t >= h->sim.time())) return SIM_EINVAL;
+    return guarded([&]() -> SimStatus {
+        const int k = max_events > 0 ? h->sim.advance_until(t, max_events) : h->sim.advance_until(t);
+        if (done) *done = k;
+        return SIM_OK;
+    });
+}
+
+/*
+4. Read-Out
+   Straight from the particle array into caller memory; no temporaries.
+   Positions are computed at the current time without drifting the array,
+   so reading never changes the trajectory or starts drift workers.
+*/
+double sim_time(const SimHandle* h) { return h ? h->sim.time() : 0.0; }
+
+int32_t sim_count(SimHandle* h) {
+    return h ? (int32_t)h->sim.slot_count() : 0;
+}
+
+SimStatus sim_read_state(SimHandle* h, SimParticleC* out, int32_t cap) {
+    if (!h || (cap > 0 && !out)) return SIM_EINVAL;
+    return guarded([&]() -> SimStatus {
+        const ParticleVec& P = h->sim.slots();
+        const double t = h->sim.time();
+        if ((size_t)std::max(cap, 0) < P.size()) return SIM_ESMALL;
+        for (size_t i = 0; i < P.size(); ++i) {
+            const Particle& p = P[i];
+            const Vec2 r = p.position_at(t);
+            out[i] = SimParticleC{r.x, r.y, p.v.x, p.v.y, p.alive ? p.rad : 0.0, p.m};
+        }
+        return SIM_OK;
+    });
+}
+
+SimStatus sim_read_positions(SimHandle* h, double* xy, int32_t cap) {
+    if (!h || (cap > 0 && !xy)) return SIM_EINVAL;
+    return guarded([&]() -> SimStatus {
+        const ParticleVec& P = h->sim.slots();
+        const double t = h->sim.time();
+        if ((size_t)std::max(cap, 0) < P.size()) return SIM_ESMALL;
+        for (size_t i = 0; i < P.size(); ++i) {
+            const Vec2 r = P[i].position_at(t);
+            xy[2 * i]     = r.x;
+            xy[2 * i + 1] = r.y;
+        }
+        return SIM_OK;
+    });
+}
+
+SimStatus sim_read_stats(SimHandle* h, SimStatsC* out) {
+    if (!h || !out || out->size < sizeof(uint32_t)) return SIM_EINVAL;
+    return guarded([&]() -> SimStatus {
+        const SimStats& s = h->sim.stats();
+        SimStatsC r{};
+        r.size           = sizeof(SimStatsC);
+        r.time           = h->sim.time();
+        r.events         = s.events;
+        r.stale          = s.stale;
+        r.cell_crossings = s.cell_crossings;
+        r.inserted       = s.inserted;
+        r.insert_blocked = s.insert_blocked;
+        r.removed        = s.removed;
+        r.bond_events    = s.bond_events;
+        r.particles      = (int32_t)h->sim.slot_count();
+        r.alive          = (int32_t)h->sim.alive_count();
+        // Keep the caller's size so it can tell which fields were filled.
+        const uint32_t n = std::min<uint32_t>(out->size, sizeof(SimStatsC));
+        std::memcpy(out, &r, n);
+        out->size = n;
+        return SIM_OK;
+    });
+}
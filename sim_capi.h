@@ -0,0 +1,110 @@
+#ifndef SIM_CAPI_H
+#define SIM_CAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+1. Purpose
+   Stable C interface for embedding the simulator from other languages
+   (Python/ctypes, Julia, Rust, C). Build it as a shared library with
+   `make libparticlesim.so` (every .cpp except main.cpp, compiled with
+   -fPIC -fvisibility=hidden).
+
+2. ABI Rules
+   - The handle is opaque; only plain C structs cross the boundary.
+   - Structs passed in start with `size` (sizeof as compiled by the
+     caller) so fields can be appended later without breaking old callers;
+     sim_config_init() fills it in. Never reorder or remove fields.
+   - Every call returns a SimStatus; C++ exceptions never escape.
+   - sim_api_version() is bumped for any incompatible change.
+
+3. Per-Call Cost
+   - Only sim_create / sim_destroy allocate once the event queue has
+     grown to its working size. Stepping reuses the queue, and the read
+     functions copy straight from the internal particle array into
+     caller-owned buffers (no staging copies).
+   - Rollback is off by default: with enable_rollback = 1 every event
+     copies the particle array into a snapshot (O(N) plus an allocation).
+   - Read functions compute positions at the current time on the fly
+     (O(N), read-only); sim_count is O(1). Reading never moves particles,
+     so it does not change the trajectory.
+   - There is no end time: handles predict without a horizon and stop
+     wherever sim_advance_until / sim_step leave them.
+   - A handle is not thread-safe; use one handle per thread.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#  define SIM_API __declspec(dllexport)
+#else
+#  define SIM_API __attribute__((visibility("default")))
+#endif
+
+#define SIM_API_VERSION 1
+
+typedef struct SimHandle SimHandle;
+
+typedef enum SimStatus {
+    SIM_OK        = 0,
+    SIM_EINVAL    = 1, /* null handle/pointer, bad size or argument */
+    SIM_ENOMEM    = 2, /* allocation failed */
+    SIM_ESMALL    = 3, /* caller buffer too small; nothing written */
+    SIM_EINTERNAL = 4  /* unexpected error inside the simulator */
+} SimStatus;
+
+typedef struct SimConfigC {
+    uint32_t size;            /* sizeof(SimConfigC) */
+    double   W, H;            /* box size */
+    double   cell_size;       /* > 0 grid, 0 all-pairs, < 0 pick automatically */
+    int32_t  enable_rollback; /* 0 / 1 (default 0, see 3.) */
+    int32_t  rollback_depth;
+    int32_t  numa_node;       /* -1 = off */
+    int32_t  huge_pages;      /* 0 off, 1 transparent, 2 explicit */
+    int32_t  collect_histograms;
+} SimConfigC;
+
+typedef struct SimParticleC {
+    double x, y, vx, vy;
+    double rad, m;
+} SimParticleC;
+
+typedef struct SimStatsC {
+    uint32_t size;            /* sizeof(SimStatsC) */
+    double   time;
+    int64_t  events, stale, cell_crossings;
+    int64_t  inserted, insert_blocked, removed, bond_events;
+    int32_t  particles;       /* slots, including removed ones */
+    int32_t  alive;
+} SimStatsC;
+
+SIM_API int32_t   sim_api_version(void);
+SIM_API void      sim_config_init(SimConfigC* cfg);
+
+SIM_API SimStatus sim_create(const SimConfigC* cfg, const SimParticleC* init,
+                             int32_t n, SimHandle** out);
+SIM_API void      sim_destroy(SimHandle* h);
+
+/* Process up to `max_events` events; *done (optional) gets the count. */
+SIM_API SimStatus sim_step(SimHandle* h, int32_t max_events, int32_t* done);
+/* Advance to time t; max_events <= 0 means no budget. */
+SIM_API SimStatus sim_advance_until(SimHandle* h, double t, int32_t max_events,
+                                    int32_t* done);
+
+SIM_API double    sim_time(const SimHandle* h);
+SIM_API int32_t   sim_count(SimHandle* h);
+
+/* Full state, one record per slot (removed slots have rad = 0). */
+SIM_API SimStatus sim_read_state(SimHandle* h, SimParticleC* out, int32_t cap);
+/* Positions only, interleaved x0 y0 x1 y1 ...; xy holds 2 * cap doubles. */
+SIM_API SimStatus sim_read_positions(SimHandle* h, double* xy, int32_t cap);
+SIM_API SimStatus sim_read_stats(SimHandle* h, SimStatsC* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CAPI_H */
@@ -0,0 +1,192 @@
+#ifndef SIM_CORO_H
+#define SIM_CORO_H
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "sim_coro.h needs C++20 coroutines (build with -std=c++20)"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "simulator.h"
+
+/*
+1. Purpose
+   Multiplex many Simulator instances (e.g. one per interactive session)
+   over a few threads. simulate() wraps the event loop in a coroutine that
+   yields after a bounded slice of work; RoundRobinExecutor resumes ready
+   coroutines in FIFO order on a small thread pool.
+
+2. Slices
+   - A slice ends after SliceBudget::events events or SliceBudget::micros
+     of wall time, whichever comes first. The clock is read every
+     `check_every` events, so a slice overshoots by at most that many.
+   - Between slices the event queue is kept (Simulator::advance_until), so
+     slicing costs no re-prediction and gives the same trajectory.
+
+3. Fairness and Latency
+   - A finished slice goes to the back of one shared FIFO, so every session
+     runs once per round. With S sessions, P threads and slice length L,
+     the wait between two slices of one session is about (S / P) * L.
+   - ExecutorStats records the longest slice and the longest wait, which is
+     the number to watch when tuning the budget.
+
+4. Notes
+   - Header-only; needs -std=c++20 and -pthread. The rest of the tree stays
+     C++17. tests/coro_test.cpp (built by `make all` when the compiler has
+     coroutines) checks sliced sessions against one run() per system.
+   - A Simulator must only be driven by one task at a time. Tasks may
+     resume on different threads; avoid cfg.numa_node (it pins the thread).
+   - An exception inside a task ends that task; run() rethrows the first one
+     after all other tasks have finished.
+*/
+
+struct SliceBudget {
+    int    events      = 1000;  // max events per slice
+    double micros      = 500.0; // max wall time per slice
+    int    check_every = 32;    // events between clock reads
+};
+
+class SimTask {
+public:
+    struct promise_type {
+        std::exception_ptr error;
+
+        SimTask get_return_object() { return SimTask(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    SimTask() = default;
+    SimTask(SimTask&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    SimTask& operator=(SimTask&& o) noexcept {
+        if (this != &o) { reset(); h_ = std::exchange(o.h_, {}); }
+        return *this;
+    }
+    SimTask(const SimTask&) = delete;
+    SimTask& operator=(const SimTask&) = delete;
+    ~SimTask() { reset(); }
+
+    bool done() const { return !h_ || h_.done(); }
+    void resume() { if (!done()) h_.resume(); }
+    std::exception_ptr error() const { return h_ ? h_.promise().error : nullptr; }
+
+private:
+    explicit SimTask(Handle h) : h_(h) {}
+    void reset() { if (h_) { h_.destroy(); h_ = {}; } }
+    Handle h_;
+};
+
+// Advance `sim` to T_end, yielding after every slice.
+inline SimTask simulate(Simulator& sim, double T_end, SliceBudget b = {}) {
+    using Clock = std::chrono::steady_clock;
+    const int step = std::max(1, std::min(b.check_every, b.events));
+    for (;;) {
+        const auto start = Clock::now();
+        for (int left = std::max(1, b.events); left > 0; ) {
+            const int chunk = std::min(left, step);
+            const int done  = sim.advance_until(T_end, chunk);
+            if (done < chunk) co_return; // reached T_end
+            left -= done;
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            if (us >= b.micros) break;
+        }
+        co_await std::suspend_always{};
+    }
+}
+
+struct ExecutorStats {
+    long long slices      = 0;   // resumptions
+    long long finished    = 0;   // tasks run to completion
+    double    max_slice_us = 0.0; // longest single resumption
+    double    max_wait_us  = 0.0; // longest time a ready task sat in the queue
+};
+
+class RoundRobinExecutor {
+public:
+    explicit RoundRobinExecutor(int threads = 1) : threads_(std::max(1, threads)) {}
+
+    // Thread-safe; may be called from inside run() by another task's owner.
+    void spawn(SimTask t) {
+        std::lock_guard<std::mutex> lk(mu_);
+        ready_.push_back(Entry{std::move(t), Clock::now()});
+        pending_++;
+        cv_.notify_one();
+    }
+
+    // Run until every spawned task has finished.
+    void run() {
+        std::vector<std::thread> pool;
+        for (int k = 1; k < threads_; ++k) pool.emplace_back([this] { work(); });
+        work();
+        for (auto& t : pool) t.join();
+        if (first_error_) std::rethrow_exception(std::exchange(first_error_, nullptr));
+    }
+
+    ExecutorStats stats() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return stats_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Entry {
+        SimTask           task;
+        Clock::time_point queued;
+    };
+
+    void work() {
+        std::unique_lock<std::mutex> lk(mu_);
+        for (;;) {
+            cv_.wait(lk, [this] { return !ready_.empty() || pending_ == 0; });
+            if (ready_.empty()) return; // pending_ == 0: all done
+
+            Entry e = std::move(ready_.front());
+            ready_.pop_front();
+            const auto start = Clock::now();
+            stats_.max_wait_us = std::max(stats_.max_wait_us, micros(start - e.queued));
+            lk.unlock();
+
+            e.task.resume();
+
+            const auto end = Clock::now();
+            lk.lock();
+            stats_.slices++;
+            stats_.max_slice_us = std::max(stats_.max_slice_us, micros(end - start));
+            if (!e.task.done()) {
+                e.queued = end;
+                ready_.push_back(std::move(e));
+                cv_.notify_one();
+                continue;
+            }
+            if (e.task.error() && !first_error_) first_error_ = e.task.error();
+            stats_.finished++;
+            if (--pending_ == 0) cv_.notify_all();
+        }
+    }
+
+    static double micros(Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    int threads_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Entry> ready_;
+    long long pending_ = 0; // spawned and not finished
+    ExecutorStats stats_;
+    std::exception_ptr first_error_;
+};
+
+#endif // SIM_CORO_H
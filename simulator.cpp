@@ -1,32 +1,53 @@
 #include "simulator.h"
+#include "numa_placement.h"
+#include "drift.h"
+#include "phase_profiler.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 
 /*
 1. Constructor
-   Move-initialize particles and leave event heap empty until run().
+   Copy particles into (optionally huge-page backed) storage and leave the
+   event heap empty until run().
 */
 Simulator::Simulator(const SimConfig& cfg, std::vector<Particle> init)
-    : cfg_(cfg), P_(std::move(init)) {}
+    : cfg_(cfg),
+      P_(init.begin(), init.end(), HugePageAllocator<Particle>(cfg.huge_pages)),
+      horizon_(cfg.T_end),
+      pq_(EventEarlier(), EventVec(HugePageAllocator<Event>(cfg.huge_pages))) {
+#ifdef SIM_FIXED_POINT
+    for (auto& p : P_) p.place(p.r); // snap r to the fixed-point grid
+#endif
+    stats_.choice.n         = (int)P_.size();
+    stats_.choice.cell_size = cfg_.cell_size;
+    stats_.choice.engine    = cfg_.cell_size > 0.0 ? "cell-grid" : "all-pairs";
+}
 
 /*
 2. Snapshot
-   Save (time, particle array) for rollback. Bounded by cfg_.rollback_depth.
+   Save (time, particle array, tethers) for rollback. Bounded by
+   cfg_.rollback_depth. Tethers are copied too: removals erase them and
+   add_bond() adds them, and undo() must revert both.
 */
 void Simulator::snapshot() {
     if (!cfg_.enable_rollback) return;
-    if ((int)undo_.size() >= cfg_.rollback_depth) {
-        // Trim by rebuilding stack (std::stack has no pop_bottom)
-        std::vector<SimState> buf;
-        buf.reserve(cfg_.rollback_depth);
-        // Move all to buffer
-        while (!undo_.empty()) { buf.push_back(undo_.top()); undo_.pop(); }
-        // Remove the oldest (last in buffer)
-        if (!buf.empty()) buf.pop_back();
-        // Rebuild stack with newest on top
-        for (auto it = buf.rbegin(); it != buf.rend(); ++it) undo_.push(std::move(*it));
-    }
-    undo_.push(SimState{t_, P_});
+    PhaseScope phase(Phase::SNAPSHOT);
+    if ((int)undo_.size() >= cfg_.rollback_depth) trim_undo(std::max(0, cfg_.rollback_depth - 1));
+    undo_.push(SimState{t_, P_, bonds_});
+}
+
+// Keep the `keep` newest snapshots.
+void Simulator::trim_undo(size_t keep) {
+    if (undo_.size() <= keep) return;
+    // Trim by rebuilding stack (std::stack has no pop_bottom)
+    std::vector<SimState> buf;
+    buf.reserve(keep);
+    // Move the newest to the buffer, drop the rest
+    while (buf.size() < keep) { buf.push_back(std::move(undo_.top())); undo_.pop(); }
+    while (!undo_.empty()) undo_.pop();
+    // Rebuild stack with newest on top
+    for (auto it = buf.rbegin(); it != buf.rend(); ++it) undo_.push(std::move(*it));
 }
 
 /*
@@ -39,40 +60,113 @@ bool Simulator::undo() {
     undo_.pop();
     t_ = s.t;
     P_ = std::move(s.P);
-    while (!pq_.empty()) pq_.pop();
+    bonds_ = std::move(s.bonds);
+    // Kicks after the restored time must run again (slack for t_ == k * dt).
+    if (cfg_.kick_dt > 0) kick_next_ = (int)std::ceil(t_ / cfg_.kick_dt - 1e-9);
     schedule_all();
     return true;
 }
 
 /*
 4. Time Advancement
-   Ballistic update of positions from current time to T.
+   Lazy ballistic update: drift_to only moves the clock. Each particle keeps
+   the time its position is valid at and is brought to t_ by advance() when
+   an event, a prediction or a read-out needs it, so an event costs O(1)
+   instead of O(N). sync_all() materializes everyone (output, rebuilds)
+   with the bulk kernel in drift.h.
 */
 void Simulator::drift_to(double T) {
-    double dt = T - t_;
-    if (dt <= 0) return;
-    for (auto& p : P_) p.r = p.r + p.v * dt;
-    t_ = T;
+    if (T > t_) t_ = T;
+}
+
+void Simulator::advance(int i) {
+    Particle& p = P_[i];
+    if (p.t == t_) return;
+    p.drift(t_ - p.t);
+    p.t = t_;
+}
+
+void Simulator::sync_all() {
+    PhaseScope phase(Phase::DRIFT);
+    if (drift_split(P_.size(), cfg_.drift_threads) == 1) {
+        bulk_drift(P_.data(), P_.size(), t_, 1);
+        return;
+    }
+    if (cfg_.numa_workers) spread_over_workers();
+    bulk_drift(P_.data(), P_.size(), t_, 0, &workers());
+}
+
+WorkerPool& Simulator::workers() {
+    if (!workers_)
+        workers_ = std::make_unique<WorkerPool>(cfg_.drift_threads, cfg_.pin_workers, cfg_.numa_workers);
+    return *workers_;
+}
+
+const ParticleVec& Simulator::particles() {
+    sync_all();
+    return P_;
+}
+
+int Simulator::alive_count() const {
+    return (int)std::count_if(P_.begin(), P_.end(), [](const Particle& p) { return p.alive; });
+}
+
+/*
+4b. NUMA Placement
+   run(), advance_until() and step() hold a NumaPinScope for the call, so
+   the caller's thread gets its affinity back on return. The first pinned
+   call copies P_ and the pending events from the node's CPUs, so first
+   touch allocates them locally; snapshots and heap growth made later while
+   pinned land there too. Later calls only pin. If pinning fails, nothing
+   moves.
+   With cfg.numa_workers, P_ is instead split across the nodes of the
+   drift workers; the event heap still follows cfg.numa_node.
+*/
+void Simulator::place_on_node() {
+    if (placed_) return;
+    placed_ = true;
+
+    ParticleVec local(P_);
+    P_.swap(local);
+
+    EventVec storage(pq_.storage()); // same order, so still a heap
+    pq_.storage().swap(storage);
+}
+
+// cfg.numa_workers: whenever P_ sits in storage the workers have not laid
+// out yet (first bulk drift, growth, restore), move it into a fresh block
+// whose pages each drift worker faulted in for its own chunk. The copy
+// then only writes to pages that are already placed.
+void Simulator::spread_over_workers() {
+    if (P_.data() == spread_) return;
+    ParticleVec local(P_.get_allocator());
+    local.reserve(P_.size());
+    first_touch(local.data(), P_.size(), workers());
+    local.assign(P_.begin(), P_.end());
+    P_.swap(local);
+    spread_ = P_.data();
 }
 
 /*
 5. Collision-Time Helpers
    Return +inf if no future collision (or moving away).
 */
+static constexpr double kGolden = 0.6180339887498949; // spawn-point sequence step
+
 double Simulator::time_to_wall_x(const Particle& p) const {
-    if (p.v.x > 0) return (cfg_.W - p.rad - p.r.x) / p.v.x;
-    if (p.v.x < 0) return (p.rad - p.r.x) / p.v.x;
+    if (p.v.x > 0) return (gap_x(p, cfg_.W) - p.rad) / p.v.x;
+    if (p.v.x < 0) return (gap_x(p, 0.0) + p.rad) / p.v.x;
     return std::numeric_limits<double>::infinity();
 }
 
 double Simulator::time_to_wall_y(const Particle& p) const {
-    if (p.v.y > 0) return (cfg_.H - p.rad - p.r.y) / p.v.y;
-    if (p.v.y < 0) return (p.rad - p.r.y) / p.v.y;
+    if (p.v.y > 0) return (gap_y(p, cfg_.H) - p.rad) / p.v.y;
+    if (p.v.y < 0) return (gap_y(p, 0.0) + p.rad) / p.v.y;
     return std::numeric_limits<double>::infinity();
 }
 
 double Simulator::time_to_pp(const Particle& A, const Particle& B) const {
-    Vec2 dr = B.r - A.r;
+    Vec2 dr = separation(A, B);
     Vec2 dv = B.v - A.v;
     const double R = A.rad + B.rad;
 
@@ -89,38 +183,547 @@ double Simulator::time_to_pp(const Particle& A, const Particle& B) const {
     return tcol;
 }
 
+// Same quadratic as time_to_pp with R = L, but the outer (larger) root:
+// the moment the pair, currently within L, reaches L while separating.
+double Simulator::time_to_stretch(const Particle& A, const Particle& B, double L) const {
+    Vec2 dr = separation(A, B);
+    Vec2 dv = B.v - A.v;
+
+    const double dvdv = dv.norm2();
+    if (dvdv <= 0) return std::numeric_limits<double>::infinity(); // rigid motion
+
+    const double dvdr = dv.dot(dr);
+    const double drdr = dr.norm2();
+    if (drdr >= L * L && dvdr > 0) return 0.0; // overstretched by round-off
+
+    const double disc = dvdr * dvdr - dvdv * (drdr - L * L);
+    if (disc < 0) return std::numeric_limits<double>::infinity();
+
+    const double tcol = (-dvdr + std::sqrt(disc)) / dvdv;
+    if (tcol <= 1e-12) return std::numeric_limits<double>::infinity();
+    return tcol;
+}
+
+// Time until i's center leaves its grid cell; dest receives the new cell.
+// Box-edge faces are skipped: the wall event always comes first there.
+double Simulator::time_to_cell_exit(int i, int& dest) const {
+    const Particle& p = P_[i];
+    const int c = grid_.cell_of[i];
+    const int cx = grid_.cell_x(c), cy = grid_.cell_y(c);
+
+    double tx = std::numeric_limits<double>::infinity();
+    double ty = std::numeric_limits<double>::infinity();
+    int dx = 0, dy = 0;
+    if (p.v.x > 0 && cx < grid_.nx - 1) { tx = gap_x(p, (cx + 1) * grid_.cw) / p.v.x; dx = 1; }
+    if (p.v.x < 0 && cx > 0)            { tx = gap_x(p, cx * grid_.cw) / p.v.x;       dx = -1; }
+    if (p.v.y > 0 && cy < grid_.ny - 1) { ty = gap_y(p, (cy + 1) * grid_.ch) / p.v.y; dy = 1; }
+    if (p.v.y < 0 && cy > 0)            { ty = gap_y(p, cy * grid_.ch) / p.v.y;       dy = -1; }
+
+    if (tx <= ty) { dest = grid_.cell_id(cx + dx, cy); return std::max(0.0, tx); }
+    dest = grid_.cell_id(cx, cy + dy);
+    return std::max(0.0, ty);
+}
+
 /*
 6. Event Scheduling
    For current state/time, compute next wall/particle events and push to heap.
+   Pair events are stored with a < b so each pair has a single key.
 */
+void Simulator::push(const Event& e) {
+    stats_.scheduled++;
+    const bool global = e.type == EventType::INSERT || e.type == EventType::PROBE ||
+                        e.type == EventType::SAMPLE || e.type == EventType::KICK;
+    if (cfg_.sparse_events && !global) {
+        own_push(e.a, e);
+        if (e.type == EventType::P_P || e.type == EventType::BOND) own_push(e.b, e);
+        return;
+    }
+    pq_.push(e);
+}
+
+// A wall hit inside an outlet span becomes a REMOVE event.
 void Simulator::schedule_wall_events(int i) {
+    advance(i);
     const auto& p = P_[i];
     double tx = time_to_wall_x(p);
     double ty = time_to_wall_y(p);
 
-    if (std::isfinite(tx) && t_ + tx <= cfg_.T_end)
-        pq_.push(Event(t_ + tx, i, -1, EventType::P_WALL_X, P_[i].coll_count, -1));
-    if (std::isfinite(ty) && t_ + ty <= cfg_.T_end)
-        pq_.push(Event(t_ + ty, i, -1, EventType::P_WALL_Y, P_[i].coll_count, -1));
+    if (std::isfinite(tx) && t_ + tx <= horizon_) {
+        const bool out = at_outlet(p.v.x > 0 ? Wall::RIGHT : Wall::LEFT, p.r.y + p.v.y * tx);
+        push(Event(t_ + tx, i, -1, out ? EventType::REMOVE : EventType::P_WALL_X,
+                   P_[i].coll_count, -1));
+    }
+    if (std::isfinite(ty) && t_ + ty <= horizon_) {
+        const bool out = at_outlet(p.v.y > 0 ? Wall::TOP : Wall::BOTTOM, p.r.x + p.v.x * ty);
+        push(Event(t_ + ty, i, -1, out ? EventType::REMOVE : EventType::P_WALL_Y,
+                   P_[i].coll_count, -1));
+    }
 }
 
+void Simulator::schedule_pair(int i, int j) {
+    const int i1 = std::min(i, j), i2 = std::max(i, j);
+    advance(i1);
+    advance(i2);
+    double dt = time_to_pp(P_[i1], P_[i2]);
+    if (std::isfinite(dt) && t_ + dt <= horizon_) {
+        push(Event(t_ + dt, i1, i2, EventType::P_P,
+                   P_[i1].coll_count, P_[i2].coll_count));
+    }
+}
+
+// Partners j > i only; used by schedule_all() so each pair is seen once.
 void Simulator::schedule_pp_events_for(int i) {
-    for (int j = i + 1; j < (int)P_.size(); ++j) {
-        double dt = time_to_pp(P_[i], P_[j]);
-        if (std::isfinite(dt) && t_ + dt <= cfg_.T_end) {
-            pq_.push(Event(t_ + dt, i, j, EventType::P_P,
-                           P_[i].coll_count, P_[j].coll_count));
-        }
+    if (!grid_.enabled()) {
+        for (int j = i + 1; j < (int)P_.size(); ++j)
+            if (P_[j].alive) schedule_pair(i, j);
+        return;
     }
+    const int cx = grid_.cell_x(grid_.cell_of[i]), cy = grid_.cell_y(grid_.cell_of[i]);
+    for (int y = std::max(0, cy - 1); y <= std::min(grid_.ny - 1, cy + 1); ++y)
+        for (int x = std::max(0, cx - 1); x <= std::min(grid_.nx - 1, cx + 1); ++x)
+            for (int j : grid_.cells[grid_.cell_id(x, y)])
+                if (j > i) schedule_pair(i, j);
 }
 
+// Every partner of i; used after i's velocity changed.
+void Simulator::schedule_partners(int i) {
+    if (!grid_.enabled()) {
+        for (int j = 0; j < (int)P_.size(); ++j)
+            if (j != i && P_[j].alive) schedule_pair(i, j);
+        return;
+    }
+    const int cx = grid_.cell_x(grid_.cell_of[i]), cy = grid_.cell_y(grid_.cell_of[i]);
+    for (int y = std::max(0, cy - 1); y <= std::min(grid_.ny - 1, cy + 1); ++y)
+        for (int x = std::max(0, cx - 1); x <= std::min(grid_.nx - 1, cx + 1); ++x)
+            for (int j : grid_.cells[grid_.cell_id(x, y)])
+                if (j != i) schedule_pair(i, j);
+}
+
+void Simulator::schedule_cell_event(int i) {
+    if (!grid_.enabled()) return;
+    advance(i);
+    int dest = -1;
+    double dt = time_to_cell_exit(i, dest);
+    if (std::isfinite(dt) && t_ + dt <= horizon_)
+        push(Event(t_ + dt, i, dest, EventType::CELL_CROSS, P_[i].coll_count, -1));
+}
+
+// Full re-prediction for a particle whose velocity just changed.
+void Simulator::reschedule(int i) {
+    PhaseScope phase(Phase::PREDICT);
+    if (cfg_.sparse_events) own_drop(i);
+    schedule_wall_events(i);
+    schedule_partners(i);
+    schedule_cell_event(i);
+    schedule_bonds(i, false);
+}
+
+// upper_only: partners j > i (schedule_all, so each bond is seen once).
+void Simulator::schedule_bonds(int i, bool upper_only) {
+    if (i >= (int)bonds_.size()) return;
+    for (const Tether& b : bonds_[i]) {
+        if ((upper_only && b.j < i) || !P_[b.j].alive) continue;
+        const int i1 = std::min(i, b.j), i2 = std::max(i, b.j);
+        advance(i1);
+        advance(i2);
+        double dt = time_to_stretch(P_[i1], P_[i2], b.L);
+        if (std::isfinite(dt) && t_ + dt <= horizon_)
+            push(Event(t_ + dt, i1, i2, EventType::BOND,
+                       P_[i1].coll_count, P_[i2].coll_count));
+    }
+}
+
+// Cells must also fit the largest particle any inlet can inject.
+void Simulator::build_grid() {
+    if (cfg_.cell_size <= 0.0) return;
+    double dmax = 0.0;
+    for (const auto& p : P_)
+        if (p.alive) dmax = std::max(dmax, 2.0 * p.rad);
+    for (const auto& in : cfg_.inlets) dmax = std::max(dmax, 2.0 * in.rad);
+    grid_.build(cfg_.W, cfg_.H, std::max(cfg_.cell_size, dmax), P_.data(), (int)P_.size());
+}
+
+// Rebuilds everything derived from P_ (queue, grid, free list) from scratch.
 void Simulator::schedule_all() {
+    PhaseScope phase(Phase::REBUILD);
+    primed_ = true;
+    while (!pq_.empty()) pq_.pop();
+    if (cfg_.sparse_events) tree_build();
+    sync_all();
+    build_grid();
+
+    free_.clear();
+    for (int i = (int)P_.size() - 1; i >= 0; --i)
+        if (!P_[i].alive) free_.push_back(i);
+    reset_hits();
+
     for (int i = 0; i < (int)P_.size(); ++i) {
+        if (!P_[i].alive) continue;
         schedule_wall_events(i);
+        schedule_cell_event(i);
     }
     for (int i = 0; i < (int)P_.size(); ++i) {
+        if (!P_[i].alive) continue;
         schedule_pp_events_for(i);
+        schedule_bonds(i, true);
     }
+    for (int k = 0; k < (int)cfg_.inlets.size(); ++k) {
+        // Next tick strictly after t_ (tick 0 would fire at t = 0).
+        schedule_inlet(k, (int)std::floor(t_ * cfg_.inlets[k].rate) + 1);
+    }
+    for (int k = 0; k < (int)probes_.size(); ++k) {
+        if (probes_[k].active && probes_[k].probe.sample_dt > 0)
+            schedule_probe(k, (int)std::floor(t_ / probes_[k].probe.sample_dt) + 1);
+    }
+    schedule_frame();
+    schedule_kick();
+}
+
+/*
+6c. Open Systems
+   Slots of removed particles are recycled LIFO from free_. A reused slot
+   continues its predecessor's coll_count so events scheduled for the old
+   occupant can never validate against the new one.
+*/
+int Simulator::insert_particle(const Particle& p) {
+    int i;
+    if (!free_.empty()) {
+        i = free_.back();
+        free_.pop_back();
+        const int cc = P_[i].coll_count + 1;
+        P_[i] = p;
+        P_[i].coll_count = cc;
+    } else {
+        i = (int)P_.size();
+        P_.push_back(p);
+    }
+    P_[i].alive = true;
+    P_[i].t = t_;
+    P_[i].place(P_[i].r);
+
+    if (cfg_.collect_histograms) {
+        if (i >= (int)hits_.size()) { hits_.resize(i + 1, 0); last_hit_.resize(i + 1, 0.0); }
+        hits_[i] = 0;
+        last_hit_[i] = t_;
+        stats_.per_particle.add(0);
+    }
+    if (grid_.enabled()) grid_.insert(i, grid_.cell_at(P_[i].r));
+    reschedule(i);
+    return i;
+}
+
+void Simulator::remove_particle(int i) {
+    if (!P_[i].alive) return;
+    if (grid_.enabled()) grid_.remove(i);
+
+    // Drop i's tethers from both sides so a recycled slot starts unbonded.
+    if (i < (int)bonds_.size()) {
+        for (const Tether& b : bonds_[i]) {
+            auto& other = bonds_[b.j];
+            other.erase(std::remove_if(other.begin(), other.end(),
+                                       [i](const Tether& x) { return x.j == i; }),
+                        other.end());
+        }
+        bonds_[i].clear();
+    }
+
+    P_[i].alive = false;
+    P_[i].coll_count++; // invalidates all pending events of i
+    if (cfg_.sparse_events) own_drop(i);
+    if (cfg_.collect_histograms && i < (int)hits_.size()) stats_.per_particle.sub(hits_[i]);
+    free_.push_back(i);
+}
+
+/*
+6d. Tethers
+   Stored per particle on both sides; bonds_ grows lazily to the highest
+   bonded index, so unbonded runs pay nothing.
+*/
+bool Simulator::add_bond(int i, int j, double max_dist) {
+    const int n = (int)P_.size();
+    if (i == j || i < 0 || j < 0 || i >= n || j >= n) return false;
+    if (!P_[i].alive || !P_[j].alive) return false;
+    advance(i);
+    advance(j);
+    if (separation(P_[i], P_[j]).norm2() > max_dist * max_dist) return false;
+
+    if ((int)bonds_.size() < n) bonds_.resize(n);
+    bonds_[i].push_back(Tether{j, max_dist});
+    bonds_[j].push_back(Tether{i, max_dist});
+    return true;
+}
+
+const std::vector<Tether>& Simulator::bonds_of(int i) const {
+    static const std::vector<Tether> none;
+    return i < (int)bonds_.size() ? bonds_[i] : none;
+}
+
+void Simulator::schedule_inlet(int k, int tick) {
+    const double t = tick / cfg_.inlets[k].rate;
+    if (t <= horizon_) push(Event(t, k, tick, EventType::INSERT, -1, -1));
+}
+
+bool Simulator::at_outlet(Wall w, double s) const {
+    for (const auto& o : cfg_.outlets)
+        if (o.wall == w && s >= o.lo && s <= o.hi) return true;
+    return false;
+}
+
+bool Simulator::overlaps(const Particle& p) {
+    auto hit = [&](int j) {
+        if (!P_[j].alive) return false;
+        advance(j);
+        const double R = p.rad + P_[j].rad;
+        return separation(p, P_[j]).norm2() < R * R;
+    };
+    if (!grid_.enabled()) {
+        for (int j = 0; j < (int)P_.size(); ++j)
+            if (hit(j)) return true;
+        return false;
+    }
+    const int c = grid_.cell_at(p.r);
+    const int cx = grid_.cell_x(c), cy = grid_.cell_y(c);
+    for (int y = std::max(0, cy - 1); y <= std::min(grid_.ny - 1, cy + 1); ++y)
+        for (int x = std::max(0, cx - 1); x <= std::min(grid_.nx - 1, cx + 1); ++x)
+            for (int j : grid_.cells[grid_.cell_id(x, y)])
+                if (hit(j)) return true;
+    return false;
+}
+
+// Spawn at the golden-ratio point of the span, touching the wall, moving in.
+void Simulator::fire_inlet(int k, int tick) {
+    const Inlet& in = cfg_.inlets[k];
+    double f = tick * kGolden;
+    f -= std::floor(f);
+    const double s = in.lo + f * (in.hi - in.lo);
+
+    Particle p;
+    p.rad = in.rad;
+    p.m   = in.m;
+#ifdef SIM_ROUGH_DISKS
+    p.I   = 0.5 * in.m * in.rad * in.rad;
+#endif
+    switch (in.wall) {
+        case Wall::LEFT:   p.place(Vec2(in.rad, s));          p.v = Vec2( in.speed, 0.0); break;
+        case Wall::RIGHT:  p.place(Vec2(cfg_.W - in.rad, s)); p.v = Vec2(-in.speed, 0.0); break;
+        case Wall::BOTTOM: p.place(Vec2(s, in.rad));          p.v = Vec2(0.0,  in.speed); break;
+        case Wall::TOP:    p.place(Vec2(s, cfg_.H - in.rad)); p.v = Vec2(0.0, -in.speed); break;
+    }
+
+    if (overlaps(p)) stats_.insert_blocked++;
+    else { insert_particle(p); stats_.inserted++; }
+    schedule_inlet(k, tick + 1);
+}
+
+/*
+6e. Soft Forces
+   Hybrid integration for hard cores plus smooth pair forces. KICK events at
+   t = k * kick_dt add dv = F / m * kick_dt to every particle; in between,
+   particles fly and collide exactly. That is velocity Verlet with the two
+   half kicks at each boundary merged (leapfrog); the very first kick is a
+   half kick so the scheme starts consistently. Velocities read between
+   kicks are therefore offset by up to half a kick.
+
+   Forces use the cell grid with a stencil wide enough for soft_cutoff
+   (ceil(cutoff / cell) cells each way). Without the main grid a private
+   one with cells of size cutoff is binned at each kick. Only particles that
+   felt a nonzero force get a new velocity, a bumped coll_count and fresh
+   predictions; everything else keeps its queued events.
+*/
+void Simulator::schedule_kick() {
+    if (!(cfg_.kick_dt > 0) || !cfg_.soft_force) return;
+    kick_next_ = std::max(kick_next_, (int)std::ceil(t_ / cfg_.kick_dt));
+    const double t = kick_next_ * cfg_.kick_dt;
+    if (t <= horizon_) push(Event(t, -1, kick_next_, EventType::KICK, -1, -1));
+}
+
+void Simulator::soft_pair(int i, int j) {
+    const Vec2 d = separation(P_[i], P_[j]);
+    const double r2 = d.norm2();
+    const double rc = cfg_.soft_cutoff;
+    if (r2 <= 0.0 || (rc > 0.0 && r2 > rc * rc)) return;
+    const double r = std::sqrt(r2);
+    const double f = cfg_.soft_force(r);
+    if (f == 0.0) return;
+    const Vec2 F = d * (f / r); // force on j; i gets -F
+    force_[j] = force_[j] + F;
+    force_[i] = force_[i] - F;
+}
+
+void Simulator::fire_kick(int k) {
+    const int n = (int)P_.size();
+    sync_all(); // forces need every position at t_
+    force_.assign(n, Vec2());
+
+    const bool use_cells = cfg_.soft_cutoff > 0.0;
+    if (use_cells && !grid_.enabled())
+        soft_grid_.build(cfg_.W, cfg_.H, cfg_.soft_cutoff, P_.data(), n);
+    const CellGrid& G = grid_.enabled() ? grid_ : soft_grid_;
+
+    if (use_cells) {
+        const int rx = (int)std::ceil(cfg_.soft_cutoff / G.cw);
+        const int ry = (int)std::ceil(cfg_.soft_cutoff / G.ch);
+        for (int c = 0; c < G.nx * G.ny; ++c) {
+            const int cx = G.cell_x(c), cy = G.cell_y(c);
+            for (int y = std::max(0, cy - ry); y <= std::min(G.ny - 1, cy + ry); ++y)
+                for (int x = std::max(0, cx - rx); x <= std::min(G.nx - 1, cx + rx); ++x)
+                    for (int i : G.cells[c])
+                        for (int j : G.cells[G.cell_id(x, y)])
+                            if (i < j) soft_pair(i, j);
+        }
+    } else {
+        for (int i = 0; i < n; ++i)
+            for (int j = i + 1; j < n; ++j)
+                if (P_[i].alive && P_[j].alive) soft_pair(i, j);
+    }
+
+    const double h = kick_first_ ? 0.5 * cfg_.kick_dt : cfg_.kick_dt;
+    std::vector<int>& moved = kicked_;
+    moved.clear();
+    for (int i = 0; i < n; ++i) {
+        if (!P_[i].alive || (force_[i].x == 0.0 && force_[i].y == 0.0)) continue;
+        P_[i].v = P_[i].v + force_[i] * (h / P_[i].m);
+        P_[i].coll_count++; // old predictions used the old velocity
+        moved.push_back(i);
+    }
+    for (int i : moved) reschedule(i);
+
+    stats_.kicks++;
+    stats_.kicked += (long long)moved.size();
+    kick_first_ = false;
+    kick_next_ = k + 1;
+    schedule_kick();
+}
+
+/*
+6f. Sparse Event Lists
+   Lubachevsky-style queue. Each particle keeps its few candidate events in
+   an unsorted list; a pair event sits in both partners' lists. A complete
+   binary tournament tree over the particles holds, at each node, the
+   particle whose list minimum is earliest, so the next event is at the root
+   and a list change costs one O(log N) leaf-to-root pass.
+   A velocity change drops the particle's list (and the partner copies of
+   its pair events) before re-prediction, so invalidated events are removed
+   instead of piling up in a global heap. The global heap only carries
+   events without an owner particle.
+*/
+void Simulator::tree_build() {
+    const int n = (int)P_.size();
+    leaves_ = 1;
+    while (leaves_ < n) leaves_ *= 2;
+    own_.resize(leaves_);
+    for (auto& l : own_) l.clear();
+    own_min_.assign(leaves_, std::numeric_limits<double>::infinity());
+    tree_.assign(2 * leaves_, -1);
+    for (int i = 0; i < leaves_; ++i) tree_[leaves_ + i] = i;
+    for (int k = leaves_ - 1; k >= 1; --k) {
+        const int l = tree_[2 * k], r = tree_[2 * k + 1];
+        tree_[k] = own_min_[l] <= own_min_[r] ? l : r;
+    }
+}
+
+// Recompute leaf i's minimum and replay the matches up to the root.
+void Simulator::tree_update(int i) {
+    double m = std::numeric_limits<double>::infinity();
+    for (const Event& e : own_[i]) m = std::min(m, e.t);
+    own_min_[i] = m;
+    for (int k = (leaves_ + i) / 2; k >= 1; k /= 2) {
+        const int l = tree_[2 * k], r = tree_[2 * k + 1];
+        const int w = own_min_[l] <= own_min_[r] ? l : r;
+        if (tree_[k] == w && w != i) break; // winner unchanged above here
+        tree_[k] = w;
+    }
+}
+
+void Simulator::own_push(int i, const Event& e) {
+    if (i >= leaves_) {
+        // Slot beyond the tree (insert_particle grew P_): rebuild wider.
+        std::vector<std::vector<Event>> keep;
+        keep.swap(own_);
+        tree_build();
+        for (int k = 0; k < (int)keep.size(); ++k) {
+            own_[k] = std::move(keep[k]);
+            if (!own_[k].empty()) tree_update(k);
+        }
+    }
+    own_[i].push_back(e);
+    if (e.t < own_min_[i]) tree_update(i);
+}
+
+void Simulator::own_erase(int i, const Event& e) {
+    auto& l = own_[i];
+    for (size_t k = 0; k < l.size(); ++k) {
+        const Event& x = l[k];
+        if (x.t == e.t && x.a == e.a && x.b == e.b && x.type == e.type) {
+            l[k] = l.back();
+            l.pop_back();
+            if (e.t <= own_min_[i]) tree_update(i);
+            return;
+        }
+    }
+}
+
+void Simulator::own_drop(int i) {
+    if (i >= leaves_ || own_[i].empty()) return;
+    for (const Event& e : own_[i]) {
+        if (e.type != EventType::P_P && e.type != EventType::BOND) continue;
+        own_erase(e.a == i ? e.b : e.a, e);
+    }
+    own_[i].clear();
+    tree_update(i);
+}
+
+// Earliest pending event over the tree and the global heap.
+bool Simulator::top_event(Event& e) const {
+    const bool has_pq = !pq_.empty();
+    if (!cfg_.sparse_events) {
+        if (has_pq) e = pq_.top();
+        return has_pq;
+    }
+    const int s = leaves_ > 0 ? tree_[1] : -1;
+    const double ts = s >= 0 ? own_min_[s] : std::numeric_limits<double>::infinity();
+    if (has_pq && pq_.top().t <= ts) { e = pq_.top(); return true; }
+    if (!std::isfinite(ts)) return false;
+    for (const Event& x : own_[s])
+        if (x.t == ts) { e = x; return true; }
+    return false;
+}
+
+// Remove the event top_event() just returned.
+void Simulator::pop_event() {
+    if (!cfg_.sparse_events) { pq_.pop(); return; }
+    const int s = tree_[1];
+    const double ts = own_min_[s];
+    if (!pq_.empty() && pq_.top().t <= ts) { pq_.pop(); return; }
+
+    auto& l = own_[s];
+    size_t k = 0;
+    while (l[k].t != ts) ++k;
+    const Event e = l[k];
+    l[k] = l.back();
+    l.pop_back();
+    tree_update(s);
+    if (e.type == EventType::P_P || e.type == EventType::BOND)
+        own_erase(e.a == s ? e.b : e.a, e);
+}
+
+/*
+6b. Cell Migration
+   Move i into cell c, then predict against the cells that entered its 3x3
+   neighbourhood. Pairs already adjacent before the move keep their events.
+*/
+void Simulator::cross_cell(int i, int c) {
+    const int ox = grid_.cell_x(grid_.cell_of[i]), oy = grid_.cell_y(grid_.cell_of[i]);
+    grid_.migrate(i, c);
+
+    const int cx = grid_.cell_x(c), cy = grid_.cell_y(c);
+    for (int y = std::max(0, cy - 1); y <= std::min(grid_.ny - 1, cy + 1); ++y)
+        for (int x = std::max(0, cx - 1); x <= std::min(grid_.nx - 1, cx + 1); ++x) {
+            if (std::abs(x - ox) <= 1 && std::abs(y - oy) <= 1) continue;
+            for (int j : grid_.cells[grid_.cell_id(x, y)])
+                if (j != i) schedule_pair(i, j);
+        }
+    schedule_cell_event(i);
 }
 
 /*
@@ -128,8 +731,12 @@ void Simulator::schedule_all() {
    If a particle's coll_count changed since scheduling, drop the event.
 */
 bool Simulator::valid(const Event& e) const {
+    if (e.type == EventType::INSERT || e.type == EventType::PROBE ||
+        e.type == EventType::KICK) return true;
+    if (e.type == EventType::SAMPLE) return e.collA == sampler_gen_;
     if (e.a >= 0 && P_[e.a].coll_count != e.collA) return false;
-    if (e.type == EventType::P_P && e.b >= 0 && P_[e.b].coll_count != e.collB) return false;
+    if ((e.type == EventType::P_P || e.type == EventType::BOND) && e.b >= 0 &&
+        P_[e.b].coll_count != e.collB) return false;
     return true;
 }
 
@@ -137,26 +744,45 @@ bool Simulator::valid(const Event& e) const {
 8. Collision Resolvers
    - Wall collisions reflect a single velocity component.
    - Particle collisions: elastic, along line-of-centers impulse.
+   - SIM_ROUGH_DISKS: a tangential impulse at the contact point reverses
+     a fraction of the tangential slip, g_t' = -beta * g_t, and couples v
+     to w. beta = -1 is smooth (no torque), beta = +1 conserves energy.
 */
+#ifdef SIM_ROUGH_DISKS
+// n: unit normal from the particle's center towards the wall.
+void Simulator::spin_wall(Particle& p, const Vec2& n) {
+    const Vec2 t(-n.y, n.x);
+    const double gt = p.v.dot(t) + p.w * p.rad;
+    const double Jt = -(1.0 + cfg_.beta) * gt / (1.0 / p.m + p.rad * p.rad / p.I);
+    p.v = p.v + t * (Jt / p.m);
+    p.w += p.rad * Jt / p.I;
+}
+#endif
+
 void Simulator::bounce_wall_x(int i) {
+#ifdef SIM_ROUGH_DISKS
+    spin_wall(P_[i], Vec2(P_[i].v.x > 0 ? 1.0 : -1.0, 0.0));
+#endif
     P_[i].v.x = -P_[i].v.x;
     P_[i].coll_count++;
 }
 
 void Simulator::bounce_wall_y(int i) {
+#ifdef SIM_ROUGH_DISKS
+    spin_wall(P_[i], Vec2(0.0, P_[i].v.y > 0 ? 1.0 : -1.0));
+#endif
     P_[i].v.y = -P_[i].v.y;
     P_[i].coll_count++;
 }
 
-void Simulator::bounce_pp(int i, int j) {
-    Particle& A = P_[i];
-    Particle& B = P_[j];
-
-    Vec2 dr = B.r - A.r;
+// Elastic exchange of the normal relative velocity; shared by contacts and
+// tethers (approaching vs. separating only flips the impulse sign).
+static bool reflect_normal(Particle& A, Particle& B) {
+    Vec2 dr = separation(A, B);
     Vec2 dv = B.v - A.v;
 
     const double dist2 = dr.norm2();
-    if (dist2 <= 0.0) return; // degenerate; skip
+    if (dist2 <= 0.0) return false; // degenerate; skip
 
     // Project relative velocity onto the normal (line of centers).
     const double rel = dv.dot(dr) / dist2;
@@ -166,81 +792,718 @@ void Simulator::bounce_pp(int i, int j) {
     Vec2 Jn = dr * rel; // direction along line of centers
     Vec2 impulse = Jn * (2.0 * mA * mB / (mA + mB));
 
-    // Apply equal and opposite impulses.
-    A.v = A.v + (impulse * (-1.0 / mA));
-    B.v = B.v + (impulse * ( 1.0 / mB));
+    // Apply equal and opposite impulses (rel < 0 when approaching, so the
+    // impulse points from B towards A).
+    A.v = A.v + (impulse * ( 1.0 / mA));
+    B.v = B.v + (impulse * (-1.0 / mB));
+    return true;
+}
+
+void Simulator::bounce_pp(int i, int j) {
+    Particle& A = P_[i];
+    Particle& B = P_[j];
+    if (!reflect_normal(A, B)) return;
+
+#ifdef SIM_ROUGH_DISKS
+    // Tangential slip at the contact point (normal impulse leaves it as is).
+    const double mA = A.m, mB = B.m;
+    const Vec2 dr = separation(A, B);
+    const Vec2 n = dr * (1.0 / std::sqrt(dr.norm2()));
+    const Vec2 t(-n.y, n.x);
+    const double gt = (A.v - B.v).dot(t) + A.w * A.rad + B.w * B.rad;
+    const double k  = 1.0 / mA + 1.0 / mB + A.rad * A.rad / A.I + B.rad * B.rad / B.I;
+    const double Jt = -(1.0 + cfg_.beta) * gt / k;
+    A.v = A.v + t * ( Jt / mA);
+    B.v = B.v + t * (-Jt / mB);
+    A.w += A.rad * Jt / A.I;
+    B.w += B.rad * Jt / B.I;
+#endif
 
     A.coll_count++;
     B.coll_count++;
 }
 
+// Tethers act at the centers, so no tangential impulse even for rough disks.
+void Simulator::bounce_bond(int i, int j) {
+    reflect_normal(P_[i], P_[j]);
+    P_[i].coll_count++;
+    P_[j].coll_count++;
+}
+
+/*
+8a. Probes
+   Collision checks cost O(active probes) per event; samples read the
+   watched particles at t_ without drifting them. Region probes use the grid to visit the covering
+   cells (one cell of slack for bookkeeping at cell edges) or scan P_
+   without it.
+*/
+int Simulator::subscribe(const Probe& p) {
+    ProbeSlot slot;
+    slot.probe = p;
+    if (!p.region) {
+        for (int id : p.ids) {
+            if (id < 0) continue;
+            if (id >= (int)slot.watched.size()) slot.watched.resize(id + 1, 0);
+            slot.watched[id] = 1;
+        }
+    }
+    probes_.push_back(std::move(slot));
+    const int k = (int)probes_.size() - 1;
+    if (p.sample_dt > 0) schedule_probe(k, (int)std::floor(t_ / p.sample_dt) + 1);
+    return k;
+}
+
+void Simulator::unsubscribe(int handle) {
+    if (handle >= 0 && handle < (int)probes_.size()) probes_[handle].active = false;
+}
+
+void Simulator::schedule_probe(int k, int tick) {
+    const double t = tick * probes_[k].probe.sample_dt;
+    if (t <= horizon_) push(Event(t, k, tick, EventType::PROBE, -1, -1));
+}
+
+void Simulator::add_sample(int i) {
+    samples_.push_back(ProbeSample{i, P_[i].position_at(t_), P_[i].v});
+}
+
+void Simulator::fire_probe(int k, int tick) {
+    if (!probes_[k].active) return;
+    samples_.clear();
+
+    const Probe& p = probes_[k].probe;
+    auto inside = [&](int j) {
+        const Vec2 r = P_[j].position_at(t_);
+        return r.x >= p.lo.x && r.x <= p.hi.x && r.y >= p.lo.y && r.y <= p.hi.y;
+    };
+    if (!p.region) {
+        for (int id : p.ids)
+            if (id >= 0 && id < (int)P_.size() && P_[id].alive) add_sample(id);
+    } else if (grid_.enabled()) {
+        const int c0 = grid_.cell_at(p.lo), c1 = grid_.cell_at(p.hi);
+        for (int y = std::max(0, grid_.cell_y(c0) - 1); y <= std::min(grid_.ny - 1, grid_.cell_y(c1) + 1); ++y)
+            for (int x = std::max(0, grid_.cell_x(c0) - 1); x <= std::min(grid_.nx - 1, grid_.cell_x(c1) + 1); ++x)
+                for (int j : grid_.cells[grid_.cell_id(x, y)])
+                    if (inside(j)) add_sample(j);
+    } else {
+        for (int j = 0; j < (int)P_.size(); ++j) {
+            if (!P_[j].alive) continue;
+            if (inside(j)) add_sample(j);
+        }
+    }
+    schedule_probe(k, tick + 1);
+    // Copy: the callback may subscribe and reallocate probes_.
+    auto cb = p.callback;
+    if (cb) cb(t_, EventType::PROBE, samples_);
+}
+
+// After a collision: tell every probe watching a participant.
+void Simulator::notify(const Event& e) {
+    const bool pair = e.type == EventType::P_P || e.type == EventType::BOND;
+    // Indexed loop with a copied callback: callbacks may subscribe.
+    for (size_t k = 0; k < probes_.size(); ++k) {
+        const ProbeSlot& s = probes_[k];
+        if (!s.active || !s.probe.callback) continue;
+        const Probe& p = s.probe;
+        auto watches = [&](int j) {
+            if (!p.region) return j < (int)s.watched.size() && s.watched[j] != 0;
+            const Vec2& r = P_[j].r;
+            return r.x >= p.lo.x && r.x <= p.hi.x && r.y >= p.lo.y && r.y <= p.hi.y;
+        };
+        if (!watches(e.a) && !(pair && watches(e.b))) continue;
+        samples_.clear();
+        add_sample(e.a);
+        if (pair) add_sample(e.b);
+        auto cb = p.callback;
+        cb(t_, e.type, samples_);
+    }
+}
+
+/*
+8b. Histograms
+   O(1) per event, no allocation: the per-particle arrays are sized when the
+   queue is (re)built or a particle is inserted. A particle moving from k to
+   k + 1 collisions shifts one count between bins of per_particle.
+   A rebuild only starts the clock of new slots; the others keep their last
+   hit so free_flight sees whole flights (clamped to t_ after undo(), which
+   can rewind past it).
+*/
+void Simulator::reset_hits() {
+    if (!cfg_.collect_histograms) return;
+    hits_.resize(P_.size(), 0);
+    last_hit_.resize(P_.size(), t_);
+    for (double& h : last_hit_) h = std::min(h, t_);
+    stats_.per_particle = LogHistogram(stats_.per_particle.lo, stats_.per_particle.hi,
+                                       stats_.per_particle.bins);
+    for (int i = 0; i < (int)P_.size(); ++i)
+        if (P_[i].alive) stats_.per_particle.add(hits_[i]);
+}
+
+void Simulator::record_hit(int i) {
+    stats_.free_flight.add(t_ - last_hit_[i]);
+    last_hit_[i] = t_;
+    stats_.per_particle.move(hits_[i], hits_[i] + 1);
+    hits_[i]++;
+}
+
+// Called after drift_to(e.t), before the event is resolved.
+void Simulator::record(const Event& e) {
+    switch (e.type) {
+        case EventType::P_WALL_X:
+            stats_.impact_speed.add(std::abs(P_[e.a].v.x));
+            record_hit(e.a);
+            break;
+        case EventType::P_WALL_Y:
+            stats_.impact_speed.add(std::abs(P_[e.a].v.y));
+            record_hit(e.a);
+            break;
+        case EventType::P_P: {
+            const Vec2 dr = separation(P_[e.a], P_[e.b]);
+            const Vec2 dv = P_[e.b].v - P_[e.a].v;
+            stats_.impact_speed.add(std::abs(dv.dot(dr)) / std::sqrt(dr.norm2()));
+            record_hit(e.a);
+            record_hit(e.b);
+            break;
+        }
+        case EventType::BOND:
+            record_hit(e.a);
+            record_hit(e.b);
+            break;
+        default:
+            return; // bookkeeping and open-system events are not collisions
+    }
+    if (last_collision_ >= 0.0) stats_.collision_gap.add(t_ - last_collision_);
+    last_collision_ = t_;
+}
+
+/*
+8c. Frames
+   One SAMPLE event is pending at a time. The frame index only moves
+   forward, so rebuilding the queue (run(), undo()) never repeats a frame.
+*/
+void Simulator::set_sampler(const Sampler& s) {
+    sampler_ = s;
+    sampler_gen_++;
+    frame_next_ = s.dt > 0 ? (int)std::ceil(t_ / s.dt) : 0;
+    schedule_frame();
+}
+
+void Simulator::schedule_frame() {
+    if (!(sampler_.dt > 0)) return;
+    frame_next_ = std::max(frame_next_, (int)std::ceil(t_ / sampler_.dt));
+    push(Event(frame_next_ * sampler_.dt, -1, frame_next_, EventType::SAMPLE, sampler_gen_, -1));
+}
+
+void Simulator::fire_frame(int k) {
+    const unsigned f = sampler_.fields;
+    Frame& fr = frame_;
+    fr.index  = k;
+    fr.t      = t_;
+    fr.fields = f;
+    fr.ids.clear(); fr.r.clear(); fr.v.clear(); fr.rad.clear(); fr.collisions.clear();
+#ifdef SIM_ROUGH_DISKS
+    fr.w.clear();
+#endif
+    for (int i = 0; i < (int)P_.size(); ++i) {
+        const Particle& p = P_[i];
+        if (!p.alive) continue;
+        fr.ids.push_back(i);
+        if (f & SAMPLE_POS) fr.r.push_back(p.position_at(t_));
+        if (f & SAMPLE_VEL) fr.v.push_back(p.v);
+        if (f & SAMPLE_RADIUS) fr.rad.push_back(p.rad);
+        if (f & SAMPLE_COLLISIONS) fr.collisions.push_back(p.coll_count);
+#ifdef SIM_ROUGH_DISKS
+        if (f & SAMPLE_SPIN) fr.w.push_back(p.w);
+#endif
+    }
+    stats_.frames++;
+    frame_next_ = k + 1;
+    schedule_frame();
+    // Copy: the callback may replace the sampler.
+    auto emit = sampler_.emit;
+    if (emit) emit(fr);
+}
+
+/*
+9. Event Processing
+   Advance to the event, resolve it, and reschedule effects.
+*/
+void Simulator::process(const Event& e, int& processed) {
+    // Cell crossings, probe samples and frames change no state: no
+    // snapshot, no event budget.
+    const bool passive   = (e.type == EventType::PROBE || e.type == EventType::SAMPLE);
+    const bool collision = (e.type != EventType::CELL_CROSS && !passive);
+    const bool particle  = (e.type != EventType::INSERT && e.type != EventType::KICK && !passive);
+    const bool pair      = (e.type == EventType::P_P || e.type == EventType::BOND);
+
+    if (collision) snapshot(); // for rollback/undo (optional)
+    set_phase(Phase::DRIFT);
+    drift_to(e.t);             // advance the clock to event time
+    if (particle) advance(e.a);
+    if (pair)     advance(e.b);
+    set_phase(Phase::OBSERVE);
+    if (cfg_.collect_histograms) record(e);
+
+    set_phase(passive ? Phase::OBSERVE : e.type == EventType::KICK ? Phase::KICK : Phase::RESOLVE);
+
+    switch (e.type) {
+        case EventType::P_WALL_X:
+            bounce_wall_x(e.a);
+            reschedule(e.a);
+            break;
+
+        case EventType::P_WALL_Y:
+            bounce_wall_y(e.a);
+            reschedule(e.a);
+            break;
+
+        case EventType::P_P:
+            bounce_pp(e.a, e.b);
+            // Reschedule events involving the two impacted particles.
+            reschedule(e.a);
+            reschedule(e.b);
+            break;
+
+        case EventType::CELL_CROSS:
+            cross_cell(e.a, e.b);
+            stats_.cell_crossings++;
+            break;
+
+        case EventType::INSERT:
+            fire_inlet(e.a, e.b);
+            break;
+
+        case EventType::REMOVE:
+            remove_particle(e.a);
+            stats_.removed++;
+            break;
+
+        case EventType::BOND:
+            bounce_bond(e.a, e.b);
+            reschedule(e.a);
+            reschedule(e.b);
+            stats_.bond_events++;
+            break;
+
+        case EventType::PROBE:
+            fire_probe(e.a, e.b);
+            break;
+
+        case EventType::SAMPLE:
+            fire_frame(e.b);
+            break;
+
+        case EventType::KICK:
+            fire_kick(e.b);
+            break;
+    }
+    if (collision) { processed++; stats_.events++; }
+    set_phase(Phase::OBSERVE);
+    if (cfg_.digest_every > 0 && collision) { // observers and cell crossings leave no trace
+        hasher_.add(e);
+        hashed_++;
+        if (hashed_ >= cfg_.digest_from && hashed_ % cfg_.digest_every == 0)
+            digests_.push_back(EventDigest{hashed_, e.t, hasher_.value()});
+    }
+
+    const bool contact = pair || e.type == EventType::P_WALL_X || e.type == EventType::P_WALL_Y;
+    if (contact && !probes_.empty()) notify(e);
+}
+
 /*
-9. Main Loop
-   Pop validated events, advance, resolve, and reschedule effects.
+10. Main Loop
+   Pop validated events and process them. pump()
+   leaves the first event past t_stop in the queue so a later slice can
+   continue from it.
 */
+int Simulator::pump(double t_stop, int budget) {
+    PhaseScope phase(Phase::QUEUE);
+    int processed = 0;
+    Event e;
+    while (processed < budget && top_event(e)) {
+        if (e.t > t_stop) break;
+        pop_event();
+        if (cfg_.memory_budget > 0 && --mem_check_ <= 0) enforce_memory_budget();
+        if (!valid(e)) { stats_.stale++; continue; }
+
+        process(e, processed);
+        set_phase(Phase::QUEUE);
+    }
+    return processed;
+}
+
+int Simulator::advance_until(double t, int max_events) {
+    // Nothing past horizon_ was predicted: widen it and rebuild. It at
+    // least doubles, so slicing far past T_end costs O(log) rebuilds.
+    if (t > horizon_) {
+        horizon_ = std::max(t, horizon_ + std::max(t - t_, std::abs(horizon_)));
+        primed_ = false;
+    }
+    NumaPinScope pin(cfg_.numa_node);
+    if (pin.pinned()) place_on_node();
+    if (!primed_) schedule_all();
+    const int done = pump(t, max_events);
+    Event next;
+    if (done < max_events || !top_event(next) || next.t > t) drift_to(t);
+    return done;
+}
+
+int Simulator::step(int n) {
+    NumaPinScope pin(cfg_.numa_node);
+    if (pin.pinned()) place_on_node();
+    if (!primed_) schedule_all();
+    return pump(std::numeric_limits<double>::infinity(), n);
+}
+
+/*
+10a. Run Budgets
+   run() stops early when cfg.max_events events were processed or
+   cfg.wall_budget seconds have passed (the clock is read every
+   kWallCheckEvery events). A stopped run stays at the time of its last
+   event instead of drifting to T_end, writes cfg.checkpoint_path if set,
+   and records why in last_run(); calling run() again (after
+   load_checkpoint() in a new process) continues the trajectory to T_end.
+   Only what 10b lists is carried over: statistics and histograms of the
+   resumed run cover its own events.
+*/
+static constexpr int kWallCheckEvery = 256;
+
 void Simulator::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const auto seconds = [&] { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+    const bool profiling = cfg_.profile_hz > 0 && phase_profiler_start(cfg_.profile_hz);
+    NumaPinScope pin(cfg_.numa_node);
+    if (pin.pinned()) place_on_node();
+    horizon_ = cfg_.T_end;
     schedule_all();
 
-    int processed = 0;
-    while (!pq_.empty() && processed < cfg_.max_events) {
-        Event e = pq_.top();
-        pq_.pop();
-
-        if (e.t > cfg_.T_end) break;
-        if (!valid(e)) continue;
-
-        snapshot();      // for rollback/undo (optional)
-        drift_to(e.t);   // advance to event time
-
-        switch (e.type) {
-            case EventType::P_WALL_X:
-                bounce_wall_x(e.a);
-                schedule_wall_events(e.a);
-                schedule_pp_events_for(e.a);
-                break;
-
-            case EventType::P_WALL_Y:
-                bounce_wall_y(e.a);
-                schedule_wall_events(e.a);
-                schedule_pp_events_for(e.a);
-                break;
-
-            case EventType::P_P:
-                bounce_pp(e.a, e.b);
-                // Reschedule events involving the two impacted particles.
-                schedule_wall_events(e.a);
-                schedule_wall_events(e.b);
-                for (int k = 0; k < (int)P_.size(); ++k) {
-                    if (k == e.a || k == e.b) continue;
-                    // Pair (min, max) to avoid duplicates
-                    int i1 = std::min(k, e.a), i2 = std::max(k, e.a);
-                    double dt1 = time_to_pp(P_[i1], P_[i2]);
-                    if (std::isfinite(dt1) && t_ + dt1 <= cfg_.T_end)
-                        pq_.push(Event(t_ + dt1, i1, i2, EventType::P_P,
-                                       P_[i1].coll_count, P_[i2].coll_count));
-
-                    i1 = std::min(k, e.b); i2 = std::max(k, e.b);
-                    double dt2 = time_to_pp(P_[i1], P_[i2]);
-                    if (std::isfinite(dt2) && t_ + dt2 <= cfg_.T_end)
-                        pq_.push(Event(t_ + dt2, i1, i2, EventType::P_P,
-                                       P_[i1].coll_count, P_[i2].coll_count));
-                }
-                break;
-        }
-        processed++;
+    RunReport rep;
+    rep.T_end = cfg_.T_end;
+    const bool timed = cfg_.wall_budget > 0;
+    for (int left = cfg_.max_events; ; ) {
+        const int chunk = timed ? std::min(left, kWallCheckEvery) : left;
+        const int done  = chunk > 0 ? pump(cfg_.T_end, chunk) : 0;
+        left -= done;
+        rep.events += done;
+
+        Event next;
+        if (done < chunk || !top_event(next) || next.t > cfg_.T_end) break; // reached T_end
+        if (left <= 0) { rep.reason = StopReason::EVENT_BUDGET; break; }
+        if (timed && seconds() >= cfg_.wall_budget) { rep.reason = StopReason::WALL_BUDGET; break; }
     }
 
     // drift remaining time if no more events
-    drift_to(cfg_.T_end);
+    if (rep.reason == StopReason::END_TIME) drift_to(cfg_.T_end);
+    sync_all();
+    if (profiling) profile_ = phase_profiler_stop();
+
+    if (rep.reason != StopReason::END_TIME && !cfg_.checkpoint_path.empty())
+        rep.checkpointed = save_checkpoint(cfg_.checkpoint_path);
+    rep.t      = t_;
+    rep.wall_s = seconds();
+    last_run_  = rep;
 
     // Print final state for quick verification.
+    if (!cfg_.print_final) return;
+    if (profiling) print_phase_profile(std::cout, profile_);
     std::cout.setf(std::ios::fixed);
     std::cout << std::setprecision(4);
+    if (rep.reason != StopReason::END_TIME) {
+        std::cout << "Stopped by " << (rep.reason == StopReason::EVENT_BUDGET ? "event" : "wall-clock")
+                  << " budget at t=" << rep.t << " of " << rep.T_end
+                  << " after " << rep.events << " events";
+        if (!cfg_.checkpoint_path.empty())
+            std::cout << (rep.checkpointed ? "; checkpoint " : "; FAILED to write checkpoint ")
+                      << cfg_.checkpoint_path;
+        std::cout << "\n";
+    }
     std::cout << "Final Time: " << t_ << "\n";
     for (int i = 0; i < (int)P_.size(); ++i) {
+        if (!P_[i].alive) continue;
         std::cout << "P" << i
                   << " r=(" << P_[i].r.x << "," << P_[i].r.y << ")"
                   << " v=(" << P_[i].v.x << "," << P_[i].v.y << ")"
+#ifdef SIM_ROUGH_DISKS
+                  << " w=" << P_[i].w
+#endif
                   << " collisions=" << P_[i].coll_count << "\n";
     }
 }
+
+/*
+10b. Checkpoints
+   The state is materialized first so every particle is valid at t_; a
+   load rebuilds the queue on the next run()/advance_until(). The kick
+   phase, frame index and digest chain travel in the header. Histograms,
+   stats, probe records and snapshots do not: a resumed run starts them
+   afresh. Event times after a load are predicted from the synced
+   positions, so a resumed run follows the uninterrupted one to rounding,
+   not bit for bit. Set the sampler before loading; set_sampler() restarts the
+   frame index from t.
+*/
+bool Simulator::save_checkpoint(const std::string& path, const CheckpointOptions& opt) {
+    sync_all();
+    CheckpointRun run;
+    if (cfg_.kick_dt > 0) {
+        run.kick_next = kick_next_;
+        run.kick_half = kick_first_;
+    }
+    if (sampler_.dt > 0) run.frame_next = frame_next_;
+    run.hashed = hashed_;
+    run.digest = hasher_.value();
+    return write_checkpoint(path, t_, cfg_.W, cfg_.H, P_.data(), P_.size(), opt, run);
+}
+
+bool Simulator::load_checkpoint(const std::string& path) {
+    std::vector<Particle> P;
+    CheckpointInfo info;
+    if (!read_checkpoint(path, P, info)) return false;
+    if (info.W != cfg_.W || info.H != cfg_.H) return false;
+
+    t_ = info.t;
+    P_.assign(P.begin(), P.end());
+    while (!undo_.empty()) undo_.pop();
+    hits_.clear(); // new particles: histograms start afresh
+    last_hit_.clear();
+    if (info.run.kick_next >= 0) {
+        kick_next_  = (int)info.run.kick_next;
+        kick_first_ = info.run.kick_half;
+    } else if (cfg_.kick_dt > 0) {
+        // Written without kicks: start them like a fresh run from t.
+        kick_next_  = (int)std::ceil(t_ / cfg_.kick_dt - 1e-9);
+        kick_first_ = true;
+    }
+    if (info.run.frame_next >= 0) frame_next_ = (int)info.run.frame_next;
+    if (info.run.hashed > 0) {
+        hashed_ = info.run.hashed;
+        hasher_.restore(info.run.digest);
+    }
+    primed_ = false;
+    return true;
+}
+
+/*
+10c. Memory Budget
+   Checked every kMemCheckEvery popped events (stale ones included: they
+   are what grows the heap). Over budget, the cheapest degradation that
+   loses nothing comes first:
+     1. release scratch buffers of features that are off (frame, probe,
+        force); buffers in use would only be refilled by the next event
+        that needs them,
+     2. compact the heap in place (drop stale entries, re-heapify in O(E),
+        shrink its storage), but only when at least 1/kMinStaleFrac of it
+        is stale,
+     3. halve cfg_.rollback_depth (down to 0) and drop old snapshots.
+   Particles, live events and recorded results (digests, histograms) are
+   never dropped; if they alone exceed the budget, mem_over_budget counts
+   the checks that could not get under it, and the check interval doubles
+   after each of them (up to kMemCheckMax) so a hopeless budget costs
+   little. Getting under the budget resets it.
+*/
+static constexpr int kMemCheckEvery = 1 << 12;
+static constexpr int kMemCheckMax   = 1 << 20;
+static constexpr int kMinStaleFrac  = 4;
+
+template <class V>
+static size_t bytes_of(const V& v) { return v.capacity() * sizeof(typename V::value_type); }
+
+template <class V>
+static bool release(V& v) {
+    if (v.capacity() == 0) return false;
+    V().swap(v);
+    return true;
+}
+
+MemoryUsage Simulator::memory_usage() const {
+    MemoryUsage m;
+    m.particles = bytes_of(P_) + bytes_of(free_);
+
+    m.events = bytes_of(pq_.storage())
+             + bytes_of(own_) + bytes_of(own_min_) + bytes_of(tree_);
+    for (const auto& l : own_) m.events += bytes_of(l);
+
+    if (!undo_.empty()) {
+        const SimState& s = undo_.top();
+        size_t each = sizeof(SimState) + bytes_of(s.P) + bytes_of(s.bonds);
+        for (const auto& b : s.bonds) each += bytes_of(b);
+        m.rollback = undo_.size() * each;
+    }
+
+    for (const CellGrid* g : {&grid_, &soft_grid_}) {
+        m.spatial += bytes_of(g->cells) + bytes_of(g->cell_of) + bytes_of(g->slot_of);
+        for (const auto& c : g->cells) m.spatial += bytes_of(c);
+    }
+    m.spatial += bytes_of(bonds_);
+    for (const auto& b : bonds_) m.spatial += bytes_of(b);
+    for (const auto& s : probes_) m.spatial += bytes_of(s.watched);
+
+    m.buffers = bytes_of(samples_) + bytes_of(force_) + bytes_of(kicked_) + bytes_of(digests_)
+              + bytes_of(hits_) + bytes_of(last_hit_)
+              + bytes_of(frame_.ids) + bytes_of(frame_.r) + bytes_of(frame_.v)
+              + bytes_of(frame_.rad) + bytes_of(frame_.collisions);
+#ifdef SIM_ROUGH_DISKS
+    m.buffers += bytes_of(frame_.w);
+#endif
+    return m;
+}
+
+void Simulator::enforce_memory_budget() {
+    if (mem_interval_ <= 0) mem_interval_ = kMemCheckEvery;
+    size_t total = memory_usage().total();
+    stats_.mem_peak = std::max(stats_.mem_peak, total);
+
+    if (total > cfg_.memory_budget) {
+        // 1. Scratch buffers nobody is using.
+        bool freed = false;
+        if (!(sampler_.dt > 0)) {
+            freed |= release(frame_.ids) | release(frame_.r) | release(frame_.v)
+                   | release(frame_.rad) | release(frame_.collisions);
+#ifdef SIM_ROUGH_DISKS
+            freed |= release(frame_.w);
+#endif
+        }
+        if (std::none_of(probes_.begin(), probes_.end(), [](const ProbeSlot& p) { return p.active; }))
+            freed |= release(samples_);
+        if (!(cfg_.kick_dt > 0) || !cfg_.soft_force)
+            freed |= release(force_) | release(kicked_);
+        if (freed) {
+            stats_.mem_flushes++;
+            total = memory_usage().total();
+        }
+    }
+
+    EventVec& heap = pq_.storage();
+    if (total > cfg_.memory_budget && !heap.empty()) {
+        // 2. Heap compaction, if enough of it is stale to pay off.
+        auto stale = [this](const Event& e) { return !valid(e); };
+        const size_t n_stale = std::count_if(heap.begin(), heap.end(), stale);
+        if (n_stale > 0 && n_stale * kMinStaleFrac >= heap.size()) {
+            heap.erase(std::remove_if(heap.begin(), heap.end(), stale), heap.end());
+            std::make_heap(heap.begin(), heap.end(), EventEarlier());
+            heap.shrink_to_fit();
+            stats_.mem_compactions++;
+            total = memory_usage().total();
+        }
+    }
+
+    // 3. Rollback depth.
+    while (total > cfg_.memory_budget && cfg_.rollback_depth > 0 && !undo_.empty()) {
+        cfg_.rollback_depth /= 2;
+        trim_undo(cfg_.rollback_depth);
+        stats_.mem_rollback_cuts++;
+        total = memory_usage().total();
+    }
+
+    if (total > cfg_.memory_budget) {
+        stats_.mem_over_budget++;
+        mem_interval_ = std::min(kMemCheckMax, 2 * mem_interval_);
+    } else {
+        mem_interval_ = kMemCheckEvery;
+    }
+    mem_check_ = mem_interval_;
+}
+
+/*
+11. Time-Reversal Validation
+   Elastic hard-disk dynamics is time reversible, so any miss after the
+   round trip is numerical drift (prediction round-off, float variants,
+   optimized kernels). The forward leg is run in `samples` segments and
+   the state is kept at each boundary; the backward leg compares against
+   the mirrored boundary. Rollback snapshots and the event budget are
+   switched off for the duration; the starting SimState, stats and config
+   are put back at the end and the queue is rebuilt from them. Probes and
+   the frame sampler are parked meanwhile. Open-system events
+   (inlets/outlets) are not reversible and make the check moot.
+*/
+ReversalReport Simulator::validate_reversal(double T, int samples) {
+    ReversalReport rep;
+    rep.T = T;
+    samples = std::max(1, samples);
+
+    sync_all();
+    const SimState start{t_, P_, bonds_};
+    const SimConfig saved_cfg = cfg_;
+    const double saved_horizon = horizon_;
+    const SimStats  saved_stats = stats_;
+    const RunReport saved_last_run = last_run_;
+    const int  saved_kick_next  = kick_next_;
+    const bool saved_kick_first = kick_first_;
+    // Histogram bookkeeping: schedule_all() rebuilds per_particle from hits_.
+    const std::vector<int>    saved_hits     = hits_;
+    const std::vector<double> saved_last_hit = last_hit_;
+    const double saved_last_collision        = last_collision_;
+    // Observers would see the round trip; park them until the end.
+    const Sampler saved_sampler = sampler_;
+    std::vector<ProbeSlot> saved_probes;
+    saved_probes.swap(probes_);
+    sampler_ = Sampler{};
+    cfg_.enable_rollback = false;
+    cfg_.print_final     = false;
+    cfg_.max_events      = std::numeric_limits<int>::max();
+    cfg_.digest_every    = 0; // the round trip is not part of the event stream
+    cfg_.profile_hz      = 0;
+    cfg_.wall_budget     = 0;
+    cfg_.checkpoint_path.clear();
+
+    const double t0 = t_, dt = T / samples;
+    std::vector<ParticleVec> fwd;
+    fwd.push_back(P_);
+    for (int k = 1; k <= samples; ++k) {
+        cfg_.T_end = t0 + k * dt;
+        run();
+        fwd.push_back(P_);
+    }
+    rep.forward_events = stats_.events - saved_stats.events;
+
+    for (auto& p : P_) {
+        p.v = p.v * -1.0;
+#ifdef SIM_ROUGH_DISKS
+        p.w = -p.w;
+#endif
+    }
+
+    auto compare = [&](const ParticleVec& ref, double elapsed) {
+        ReversalPoint pt{elapsed, 0.0, 0.0};
+        int n = 0;
+        for (size_t i = 0; i < P_.size() && i < ref.size(); ++i) {
+            if (!P_[i].alive || !ref[i].alive) continue;
+            const double e2 = (P_[i].r - ref[i].r).norm2();
+            pt.max_err = std::max(pt.max_err, std::sqrt(e2));
+            pt.rms_err += e2;
+            n++;
+        }
+        pt.rms_err = n > 0 ? std::sqrt(pt.rms_err / n) : 0.0;
+        rep.err.push_back(pt);
+    };
+
+    compare(fwd[samples], 0.0);
+    const long long mid_events = stats_.events;
+    for (int j = 1; j <= samples; ++j) {
+        cfg_.T_end = t0 + T + j * dt;
+        run();
+        compare(fwd[samples - j], j * dt);
+    }
+    rep.backward_events = stats_.events - mid_events;
+
+    for (size_t i = 0; i < P_.size() && i < start.P.size(); ++i)
+        if (P_[i].alive && start.P[i].alive)
+            rep.max_vel_err = std::max(rep.max_vel_err, std::sqrt((P_[i].v + start.P[i].v).norm2()));
+
+    cfg_   = saved_cfg;
+    horizon_ = saved_horizon;
+    stats_ = saved_stats;
+    last_run_ = saved_last_run;
+    kick_next_  = saved_kick_next;
+    kick_first_ = saved_kick_first;
+    hits_           = saved_hits;
+    last_hit_       = saved_last_hit;
+    last_collision_ = saved_last_collision;
+    sampler_ = saved_sampler;
+    probes_.swap(saved_probes);
+    t_     = start.t;
+    P_     = start.P;
+    bonds_ = start.bonds;
+    schedule_all();
+    return rep;
+}
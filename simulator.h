@@ -1,16 +1,30 @@
 #ifndef SIMULATOR_H
 #define SIMULATOR_H
 
+#include <functional>
+#include <string>
 #include <vector>
 #include <queue>
 #include <stack>
 #include <limits>
+#include <memory>
 #include <iostream>
 #include <iomanip>
 
 #include "vec2.h"
 #include "particle.h"
 #include "event.h"
+#include "hugepage_alloc.h"
+#include "grid.h"
+#include "stats.h"
+#include "flow.h"
+#include "bond.h"
+#include "probe.h"
+#include "sample.h"
+#include "checkpoint.h"
+#include "worker_pool.h"
+#include "digest.h"
+#include "phase_profiler.h"
 
 /*
 1. Purpose
@@ -18,30 +32,107 @@
 
 2. Data Structures
    - priority_queue<Event, …, EventEarlier> : schedules future events by time
-   - stack<SimState> : rollback snapshots (time + particle array)
+   - stack<SimState> : rollback snapshots (time, particle array, tethers)
+   - CellGrid : optional spatial cells owning particles (cfg.cell_size > 0)
+   - Sparse-event mode (cfg.sparse_events): per-particle event lists under
+     a tournament tree replace the global heap for particle events
 
 3. Workflow
    a) Schedule initial wall and pair events from t = 0.
-   b) Pop earliest event, drift system to event time, apply collision.
-   c) Reschedule newly affected events (for impacted particles).
-   d) Repeat until T_end or event budget reached.
+   b) Pop earliest event, advance the clock to its time, drift only the
+      particles involved (each particle keeps its own time), apply it.
+   c) Reschedule newly affected events (for impacted particles). With the
+      grid, pair prediction only scans the 3x3 cell neighbourhood, and a
+      CELL_CROSS event migrates a particle and predicts against the cells
+      that just became adjacent.
+   d) Repeat until T_end or an event / wall-clock budget is reached; a
+      budget stop stays at the current time and can write a checkpoint.
+      advance_until()/step() run the same loop in slices without
+      rebuilding the queue.
+   e) Open systems: INSERT events inject particles at inlets and REMOVE
+      events drop them at outlets. Freed slots go on a free list and are
+      reused in O(1); only the affected particle's events and grid cell
+      are touched.
+   f) Tethers (add_bond) schedule BOND events between bonded pairs,
+      independent of the grid.
+   g) Probes (subscribe) report collisions of watched particles and emit
+      periodic PROBE samples, reading positions at t without drifting.
+   h) A sampler (set_sampler) emits whole-system frames from SAMPLE events
+      at exact multiples of dt; only those events read every position.
+   i) Hybrid mode (cfg.kick_dt > 0): KICK events apply smooth pair forces
+      every kick_dt (velocity Verlet, see 6e in simulator.cpp); hard-core
+      collisions stay exact in between.
+   j) Digests (cfg.digest_every > 0) hash the processed event stream for
+      comparing builds (digest.h).
+   k) Profiling (cfg.profile_hz > 0): run() samples the event-loop phase
+      tag with SIGPROF and reports a per-phase profile (phase_profiler.h).
+   l) Memory budget (cfg.memory_budget): memory_usage() accounts bytes per
+      subsystem; over budget the loop releases scratch buffers, purges
+      stale heap entries and halves the rollback depth (see 10c).
 
 4. Correctness Helpers
    - Stale-event invalidation via collision counters (coll_count).
+
+5. Memory Placement
+   - With cfg.numa_node >= 0, run(), advance_until() and step() pin their
+     thread to that node for the call (the caller's affinity is restored
+     on return); the first such call re-touches P_ and the event heap
+     storage so they are node-local.
+   - With cfg.numa_workers the bulk-drift workers are spread over all
+     online nodes and P_ is first-touched chunk by chunk from the worker
+     that drifts it (see 4b), so a multi-socket drift streams local memory.
+   - cfg.huge_pages backs P_, snapshot slots and the heap with 2 MB pages
+     (see hugepage_alloc.h).
 */
 
 struct SimConfig {
     double W        = 10.0; // box width  (x in [0, W])
     double H        = 10.0; // box height (y in [0, H])
     double T_end    = 12.0; // simulation end time
-    int    max_events = 2000;
+    int    max_events = 2000;   // event budget per run(); stops at the current time
+    double wall_budget = 0.0;   // wall-clock budget per run() in seconds (0 = none)
+    std::string checkpoint_path; // written when a budget stops run() (empty = none)
     bool   enable_rollback = true;
     int    rollback_depth  = 8; // number of snapshots to retain
+    int    numa_node  = -1;   // pin run() and its storage to this node (-1 = off)
+    HugePages huge_pages = HugePages::OFF; // page backing for P_, snapshots, heap
+    double cell_size  = 0.0;  // > 0 enables the cell grid (raised to max diameter)
+    bool   print_final = true; // print the final state at the end of run()
+#ifdef SIM_ROUGH_DISKS
+    double beta = -1.0; // tangential restitution: -1 smooth, +1 perfectly rough
+#endif
+    std::vector<Inlet>  inlets;  // particle sources (see flow.h)
+    std::vector<Outlet> outlets; // particle sinks
+    bool   collect_histograms = false; // fill SimStats histograms in run()
+    double kick_dt     = 0.0; // > 0 enables soft-force kicks at this interval
+    double soft_cutoff = 0.0; // pair force range (0 = all pairs, O(N^2))
+    std::function<double(double)> soft_force; // |F|(r) along r_ij, > 0 repulsive
+    int    drift_threads = 0; // worker pool size for bulk drift (0 = all cores)
+    long long digest_every = 0; // events per event-stream digest (0 = off, see digest.h)
+    long long digest_from  = 0; // no digests for event counts below this
+    std::size_t memory_budget = 0; // bytes; degrade when exceeded (0 = unlimited)
+    double profile_hz    = 0;     // SIGPROF phase sampling during run() (0 = off)
+    bool   pin_workers   = false; // pin persistent worker threads to CPUs
+    bool   numa_workers  = false; // spread workers over NUMA nodes, P_ chunks local to them
+    bool   sparse_events = false; // per-particle event lists + tournament tree
+};
+
+using ParticleVec = std::vector<Particle, HugePageAllocator<Particle>>;
+using EventVec    = std::vector<Event,    HugePageAllocator<Event>>;
+
+// priority_queue with its storage exposed (the standard keeps it as the
+// protected member c): memory accounting reads the capacity, and the
+// memory budget compacts in place.
+struct EventHeap : std::priority_queue<Event, EventVec, EventEarlier> {
+    using std::priority_queue<Event, EventVec, EventEarlier>::priority_queue;
+    EventVec&       storage()       { return c; }
+    const EventVec& storage() const { return c; }
 };
 
 struct SimState {
-    double               t;
-    std::vector<Particle> P;
+    double      t;
+    ParticleVec P;
+    std::vector<std::vector<Tether>> bonds; // per-particle tethers (see bonds_)
 };
 
 class Simulator {
@@ -49,38 +140,198 @@ public:
     // 1) Construction
     Simulator(const SimConfig& cfg, std::vector<Particle> init);
 
-    // 2) Run simulation to cfg.T_end
+    // 2) Run simulation to cfg.T_end, or until a budget stops it (see
+    //    last_run() and section 10a in simulator.cpp)
     void run();
 
+    // 2b) Incremental stepping: the event queue survives between calls
+    //     (built on first use, after undo() or run()). advance_until stops
+    //     at time t unless the budget runs out first; a t past the
+    //     prediction horizon (initially cfg.T_end) moves the horizon past
+    //     t, at least doubling it (one rebuild; short slices past T_end
+    //     rebuild O(log t) times, and each rebuild re-predicts from the
+    //     state synced at t, so later event times can move by an ulp).
+    //     cfg.T_end itself never changes. step
+    //     processes up to n events before the horizon. Both return the
+    //     number of events processed.
+    int advance_until(double t, int max_events = std::numeric_limits<int>::max());
+    int step(int n);
+
     // 3) Optional: rollback to a previous snapshot (reschedules events)
     bool undo();
 
+    // 4) Current state; particles() first drifts everyone to time()
+    double             time() const { return t_; }
+    const ParticleVec& particles();
+    // Read-only access without drifting: each slot's r is valid at its own
+    // t (read positions with Particle::position_at(time())). O(1) / O(N).
+    const ParticleVec& slots() const { return P_; }
+    int                slot_count() const { return (int)P_.size(); }
+    int                alive_count() const;
+
+    // 4b) Counters and engine metadata (see engine_select.h)
+    const SimStats& stats() const { return stats_; }
+    const std::vector<EventDigest>& digests() const { return digests_; }
+    const PhaseProfile& profile() const { return profile_; } // last profiled run()
+    MemoryUsage memory_usage() const;
+    const RunReport& last_run() const { return last_run_; }
+    void set_engine_choice(const EngineChoice& c) { stats_.choice = c; }
+
+    // 5) Open systems: add or remove a particle at the current time.
+    //    insert_particle returns the (possibly recycled) slot index.
+    int  insert_particle(const Particle& p);
+    void remove_particle(int i);
+
+    // 6) Tethers: keep |r_i - r_j| <= max_dist. Fails (returns false) if the
+    //    pair is invalid or already farther apart than max_dist.
+    bool add_bond(int i, int j, double max_dist);
+    const std::vector<Tether>& bonds_of(int i) const;
+
+    // 7) Streaming queries (see probe.h); returns a handle for unsubscribe.
+    int  subscribe(const Probe& p);
+    void unsubscribe(int handle);
+
+    // 7a) Frame output at t = k * dt (see sample.h); dt <= 0 turns it off.
+    void set_sampler(const Sampler& s);
+
+    // 7a') Checkpoints (see checkpoint.h). Loading replaces the time and
+    //      all particle slots (the box must match) and restores the kick
+    //      phase, frame index and digest chain; bonds, probes and the
+    //      sampler stay as configured. Stats, histograms and snapshots are
+    //      not restored.
+    bool save_checkpoint(const std::string& path, const CheckpointOptions& opt = {});
+    bool load_checkpoint(const std::string& path);
+
+    // 7b) Time-reversal check: run T forward, negate velocities, run T
+    //     back and measure how far the state misses the start. The
+    //     simulator is restored afterwards (state, stats, last_run() and queue).
+    ReversalReport validate_reversal(double T, int samples = 8);
+
 private:
-    // 4) Core helpers
+    // 8) Core helpers
     void snapshot();
+    void push(const Event& e);
+    void process(const Event& e, int& processed);
+    int  pump(double t_stop, int budget);
+    bool top_event(Event& e) const;
+    void pop_event();
+    void own_push(int i, const Event& e);
+    void own_drop(int i);
+    void own_erase(int i, const Event& e);
+    void tree_update(int i);
+    void tree_build();
     void schedule_all();
     void schedule_wall_events(int i);
     void schedule_pp_events_for(int i);
+    void schedule_partners(int i);
+    void schedule_pair(int i, int j);
+    void schedule_cell_event(int i);
+    void reschedule(int i);
+    void schedule_bonds(int i, bool upper_only);
+    void build_grid();
+    void cross_cell(int i, int c);
     bool valid(const Event& e) const;
     void drift_to(double T);
+    void advance(int i);
+    void sync_all();
+    void place_on_node();
+    void spread_over_workers();
+    void schedule_inlet(int k, int tick);
+    void fire_inlet(int k, int tick);
+    bool at_outlet(Wall w, double s) const;
+    bool overlaps(const Particle& p);
+    void schedule_probe(int k, int tick);
+    void fire_probe(int k, int tick);
+    void notify(const Event& e);
+    void add_sample(int i);
+    void schedule_frame();
+    void fire_frame(int k);
+    void schedule_kick();
+    void fire_kick(int k);
+    void soft_pair(int i, int j);
+    void record(const Event& e);
+    void record_hit(int i);
+    void reset_hits();
+    void trim_undo(size_t keep);
+    void enforce_memory_budget();
 
-    // 5) Collision-time calculators
+    // 9) Collision-time calculators
     double time_to_wall_x(const Particle& p) const;
     double time_to_wall_y(const Particle& p) const;
     double time_to_pp(const Particle& A, const Particle& B) const;
+    double time_to_cell_exit(int i, int& dest) const;
+    double time_to_stretch(const Particle& A, const Particle& B, double L) const;
 
-    // 6) Collision resolvers (elastic)
+    // 10) Collision resolvers (elastic)
     void bounce_wall_x(int i);
     void bounce_wall_y(int i);
     void bounce_pp(int i, int j);
+    void bounce_bond(int i, int j);
+#ifdef SIM_ROUGH_DISKS
+    void spin_wall(Particle& p, const Vec2& n);
+#endif
 
 private:
     SimConfig cfg_;
-    std::vector<Particle> P_;
+    ParticleVec P_;
     double t_ = 0.0;
+    double horizon_;      // no events are predicted past this (>= cfg_.T_end
+                          // once advance_until has gone beyond it)
+
+    EventHeap pq_;
+    bool primed_ = false; // pq_ holds the predictions for the current state
+    bool placed_ = false; // P_ and pq_ were first-touched on cfg_.numa_node
+    const Particle* spread_ = nullptr; // P_ storage first-touched by the workers
+
+    // Event-stream digests (cfg.digest_every > 0).
+    EventHasher hasher_;
+    long long   hashed_ = 0; // state-changing events folded into hasher_
+    std::vector<EventDigest> digests_;
+    PhaseProfile profile_;
+    RunReport    last_run_;
 
-    std::priority_queue<Event, std::vector<Event>, EventEarlier> pq_;
+    // Persistent workers for parallel sections; created on first use with
+    // cfg.drift_threads threads (see worker_pool.h).
+    std::unique_ptr<WorkerPool> workers_;
+    WorkerPool& workers();
+
+    // Sparse-event mode: particle events live in own_[owner] (pair events in
+    // both lists); tree_ is a tournament tree over each list's minimum, and
+    // pq_ keeps only the particle-less events (INSERT, PROBE, SAMPLE, KICK).
+    std::vector<std::vector<Event>> own_;
+    std::vector<double> own_min_; // earliest time per leaf (inf if empty)
+    std::vector<int>    tree_;    // tree_[k]: leaf with the earliest event below k
+    int                 leaves_ = 0;
+
+    int mem_check_ = 0;        // popped events until the next budget check
+    int mem_interval_ = 0;     // current check interval (grows while over budget)
     std::stack<SimState> undo_;
+    CellGrid grid_;
+    SimStats stats_;
+    std::vector<int> free_; // recycled particle slots (alive == false)
+    std::vector<std::vector<Tether>> bonds_; // per-particle tethers (both sides)
+    std::vector<int>    hits_;     // collisions per particle (histograms)
+    std::vector<double> last_hit_; // time of each particle's last velocity change
+    double last_collision_ = -1.0; // time of the previous collision (-1 = none)
+
+    struct ProbeSlot {
+        Probe probe;
+        std::vector<char> watched; // by particle slot (id probes)
+        bool active = true;
+    };
+    std::vector<ProbeSlot>   probes_;
+    std::vector<ProbeSample> samples_; // reused callback buffer
+
+    Sampler sampler_;
+    Frame   frame_;          // reused frame buffer
+    int     frame_next_ = 0; // next frame index to emit
+    int     sampler_gen_ = 0; // bumped by set_sampler (stales SAMPLE events)
+
+    int  kick_next_  = 0;     // next kick index
+    bool kick_first_ = true;  // the first kick is a half kick (Verlet start)
+    std::vector<Vec2> force_; // per-particle soft force (reused)
+    std::vector<int>  kicked_; // particles whose velocity the kick changed
+    CellGrid soft_grid_;      // cutoff cells when the main grid is off
 };
 
 #endif // SIMULATOR_H
@@ -0,0 +1,101 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+/*
+1. Purpose
+   Counters and run metadata exposed by Simulator::stats().
+
+2. Notes
+   - Counters accumulate across repeated run() calls.
+   - EngineChoice is filled from the config at construction and overwritten
+     by make_simulator() with the estimates that drove its decision.
+   - Histograms are filled only with cfg.collect_histograms. Mean free time
+     predicts the load: a gas of N particles generates about
+     N / free_flight.mean() velocity changes per unit time, i.e. roughly
+     half as many pair events (two particles each), plus wall hits.
+*/
+
+struct EngineChoice {
+    std::string engine = "all-pairs"; // "all-pairs" or "cell-grid"
+    double cell_size   = 0.0;         // requested grid cell size (0 = none)
+    int    n           = 0;           // particle count
+    double packing_fraction = 0.0;    // sum of disk areas / box area
+    double radius_spread = 1.0;       // largest radius / rms radius
+    double occupancy   = 0.0;         // expected particles per heuristic grid cell
+    bool   by_trial    = false;       // picked by timed trial runs
+    double trial_us_per_event = 0.0;  // winning trial cost (if by_trial)
+};
+
+struct SimStats {
+    long long events         = 0; // processed events (cell crossings excluded)
+    long long stale          = 0; // popped events dropped by validation
+    long long cell_crossings = 0; // CELL_CROSS migrations
+    long long inserted       = 0; // particles injected at inlets
+    long long insert_blocked = 0; // inlet ticks skipped (spawn point occupied)
+    long long removed        = 0; // particles taken out at outlets
+    long long bond_events    = 0; // tether stretch bounces
+    long long frames         = 0; // SAMPLE frames emitted
+    long long kicks          = 0; // soft-force KICK events
+    long long kicked         = 0; // particles re-predicted after a kick
+    long long scheduled      = 0; // events pushed (heap or per-particle lists)
+    long long mem_flushes      = 0; // budget: scratch buffers released
+    long long mem_compactions  = 0; // budget: stale events purged from the heap
+    long long mem_rollback_cuts = 0; // budget: rollback depth halvings
+    long long mem_over_budget  = 0; // budget checks still over after degrading
+    std::size_t mem_peak       = 0; // largest total seen by budget checks (bytes)
+    EngineChoice choice;
+
+    LogHistogram free_flight{1e-6, 1e4, 60};   // time between a particle's velocity changes
+    LogHistogram collision_gap{1e-9, 1e3, 60}; // time between consecutive collisions
+    LogHistogram impact_speed{1e-4, 1e4, 48};  // normal approach speed at contact
+    LogHistogram per_particle{1, 1e6, 48};     // collisions per live particle (0 -> underflow)
+};
+
+// Simulator::memory_usage(): bytes held per subsystem (container
+// capacities).
+struct MemoryUsage {
+    std::size_t particles = 0; // particle array
+    std::size_t events    = 0; // event heap, sparse lists and tree
+    std::size_t rollback  = 0; // undo snapshots
+    std::size_t spatial   = 0; // cell grids, tethers, probe masks
+    std::size_t buffers   = 0; // frame, probe, force and digest buffers, per-particle stats
+    std::size_t total() const { return particles + events + rollback + spatial + buffers; }
+};
+
+// Simulator::last_run(): how the last run() ended. A budget stop leaves
+// the state at t (nothing is drifted towards T_end); run() again resumes.
+enum class StopReason { END_TIME, EVENT_BUDGET, WALL_BUDGET };
+
+struct RunReport {
+    StopReason  reason = StopReason::END_TIME;
+    double      t      = 0.0; // simulated time reached
+    double      T_end  = 0.0; // target of the run
+    long long   events = 0;   // events processed by this run() call
+    double      wall_s = 0.0; // wall time of this run() call
+    bool        checkpointed = false; // cfg.checkpoint_path was written
+};
+
+// Result of Simulator::validate_reversal(). err[j] compares the backward
+// run after j * dt of reversed time with the forward run at T - j * dt,
+// so err.back() is the distance from the initial state.
+struct ReversalPoint {
+    double elapsed;  // time since velocities were negated
+    double max_err;  // max position error over particles
+    double rms_err;  // rms position error
+};
+
+struct ReversalReport {
+    double T = 0.0;                  // forward (and backward) duration
+    long long forward_events  = 0;
+    long long backward_events = 0;
+    double max_vel_err = 0.0;        // max |v_end + v_start| at the end
+    std::vector<ReversalPoint> err;  // error growth, j = 0 .. samples
+};
+
+#endif // STATS_H
@@ -0,0 +1,29 @@
+#include "../render.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/*
+1. Purpose
+   Renders a checkpoint written by Simulator::save_checkpoint() (or a
+   budget-stopped run()) to PNG or PPM, for looking at big runs offline.
+
+2. Build and Run
+   make ckpt_render   (or: g++ -std=c++17 -O2 -pthread tools/ckpt_render.cpp
+                       $(ls *.cpp | grep -v -e main.cpp -e sim_capi) -o ckpt_render)
+   ./ckpt_render <checkpoint> <image.png|image.ppm> [width] [threads]
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <checkpoint> <image.png|image.ppm> [width] [threads]\n", argv[0]);
+        return 2;
+    }
+    RenderOptions opt;
+    if (argc > 3) opt.width   = std::atoi(argv[3]);
+    if (argc > 4) opt.threads = std::atoi(argv[4]);
+    if (!render_checkpoint(argv[1], opt, argv[2])) {
+        std::fprintf(stderr, "cannot render %s to %s\n", argv[1], argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "worker_pool.h"
+#include "numa_placement.h"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+1. Spin-Then-Park Barrier
+*/
+static inline void cpu_relax() {
+#if defined(__SSE2__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+static int hardware_threads() {
+    return (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+SpinBarrier::SpinBarrier(int n) : n_(std::max(1, n)), may_spin_(n <= hardware_threads()) {}
+
+void SpinBarrier::arrive_and_wait() {
+    const unsigned g = gen_.load();
+    if (count_.fetch_add(1) + 1 == n_) {
+        count_.store(0);
+        gen_.fetch_add(1);
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lk(mu_);
+            cv_.notify_all();
+        }
+        return;
+    }
+
+    const int budget = may_spin_ ? spin_.load(std::memory_order_relaxed) : 0;
+    for (int i = 0; i < budget; ++i) {
+        if (gen_.load() != g) {
+            if (budget < kMaxSpin) spin_.store(std::min(kMaxSpin, 2 * budget), std::memory_order_relaxed);
+            return;
+        }
+        cpu_relax();
+    }
+
+    // seq_cst on sleepers_ and gen_ pairs with the releaser's
+    // gen_ bump / sleepers_ read: one of the two always sees the other.
+    std::unique_lock<std::mutex> lk(mu_);
+    sleepers_.fetch_add(1);
+    cv_.wait(lk, [&] { return gen_.load() != g; });
+    sleepers_.fetch_sub(1);
+    if (may_spin_) spin_.store(std::max(16, budget / 2), std::memory_order_relaxed);
+}
+
+/*
+2. Pinning
+*/
+static void pin_to_nth_cpu(int k) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    const int count = CPU_COUNT(&allowed);
+    if (count <= 0) return;
+    int want = k % count;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        if (want-- > 0) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(c, &one);
+        pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        return;
+    }
+#else
+    (void)k;
+#endif
+}
+
+/*
+3. Pool
+   Both barriers include the caller: start_ publishes job_/tasks_ to the
+   workers, done_ publishes their results back.
+*/
+WorkerPool::WorkerPool(int threads, bool pin, bool numa)
+    : n_(threads > 0 ? threads : hardware_threads()), start_(n_), done_(n_) {
+    const std::vector<int> nodes = numa ? numa_online_nodes() : std::vector<int>();
+    threads_.reserve(n_ - 1);
+    for (int k = 1; k < n_; ++k) {
+        const int node = numa ? nodes[(std::size_t)k * nodes.size() / n_] : -1;
+        threads_.emplace_back([this, k, pin, node] {
+            if (node >= 0) numa_pin_to_node(node);
+            else if (pin) pin_to_nth_cpu(k);
+            work(k);
+        });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop_ = true;
+    start_.arrive_and_wait();
+    for (auto& t : threads_) t.join();
+}
+
+void WorkerPool::drain(int w) {
+    if (fixed_) {
+        for (int k = w; k < tasks_; k += n_) (*job_)(k);
+        return;
+    }
+    for (int k; (k = next_.fetch_add(1, std::memory_order_relaxed)) < tasks_; ) (*job_)(k);
+}
+
+void WorkerPool::work(int k) {
+    for (;;) {
+        start_.arrive_and_wait();
+        if (stop_) return;
+        drain(k);
+        done_.arrive_and_wait();
+    }
+}
+
+void WorkerPool::run(int tasks, const std::function<void(int)>& f) {
+    dispatch(tasks, f, false);
+}
+
+void WorkerPool::run_static(int tasks, const std::function<void(int)>& f) {
+    dispatch(tasks, f, true);
+}
+
+void WorkerPool::dispatch(int tasks, const std::function<void(int)>& f, bool fixed) {
+    if (tasks <= 0) return;
+    if (n_ == 1 || tasks == 1) { // task 0 is worker 0's anyway
+        for (int k = 0; k < tasks; ++k) f(k);
+        return;
+    }
+    job_   = &f;
+    tasks_ = tasks;
+    fixed_ = fixed;
+    next_.store(0, std::memory_order_relaxed);
+    start_.arrive_and_wait();
+    drain(0);
+    done_.arrive_and_wait();
+    job_ = nullptr;
+}
@@ -0,0 +1,88 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+1. Purpose
+   Persistent fork-join workers for the parallel paths of Simulator (bulk
+   drift, and anything added later). Threads are created once and reused,
+   so a parallel section costs two barrier crossings instead of thread
+   creation plus condition-variable wake-ups.
+
+2. Barrier
+   - SpinBarrier spins on a generation counter for a while, then parks on
+     a condition variable. The last thread to arrive bumps the generation
+     and only takes the mutex if somebody is parked.
+   - The spin budget adapts: a wait that ends while spinning doubles it
+     (up to kMaxSpin), a wait that had to park halves it. Busy fine-grained
+     loops settle on pure spinning; idle pools settle on parking and stop
+     burning cores.
+   - With more threads than hardware threads spinning only delays the
+     thread being waited for, so such barriers never spin.
+
+3. Pool
+   - run(tasks, f) calls f(0 .. tasks-1) across the workers and the
+     calling thread, which takes part as worker 0. Tasks are handed out
+     with one atomic counter; run() returns when all of them are done.
+   - run_static(tasks, f) hands task k to worker k % size() instead, so
+     the same task index always runs on the same thread. Memory a task
+     first-touches stays local to the thread that later works on it.
+   - pin = true binds worker k to the k-th CPU of the process affinity
+     mask (Linux; elsewhere a no-op). numa = true instead spreads workers
+     over the online NUMA nodes in blocks (worker k on node number
+     k * nodes / size()). The calling thread is left alone either way.
+   - run() is not reentrant and must be called from one thread at a time.
+*/
+
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int n);
+    void arrive_and_wait();
+
+    static constexpr int kMaxSpin = 1 << 14; // spin iterations before parking
+
+private:
+    const int n_;
+    const bool may_spin_;
+    std::atomic<int> count_{0};
+    std::atomic<unsigned> gen_{0};
+    std::atomic<int> sleepers_{0};
+    std::atomic<int> spin_{256};
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+class WorkerPool {
+public:
+    // threads <= 0: std::thread::hardware_concurrency().
+    explicit WorkerPool(int threads = 0, bool pin = false, bool numa = false);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return n_; }
+    void run(int tasks, const std::function<void(int)>& f);
+    void run_static(int tasks, const std::function<void(int)>& f);
+
+private:
+    void dispatch(int tasks, const std::function<void(int)>& f, bool fixed);
+    void work(int k);
+    void drain(int k);
+
+    const int n_;
+    SpinBarrier start_, done_;
+    const std::function<void(int)>* job_ = nullptr;
+    int tasks_ = 0;
+    bool fixed_ = false; // run_static: task k belongs to worker k % n_
+    std::atomic<int> next_{0};
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+#endif // WORKER_POOL_H